@@ -0,0 +1,100 @@
+/**
+ *  Compression of message payload.
+ *
+ *  Payload parts of at least a threshold size may be compressed by a
+ *  codec.  The codec name and the original part sizes are recorded
+ *  in the label object under the reserved "zio.codec" key so that a
+ *  recipient can decompress without prior agreement.  Applications
+ *  must not use that key themselves.  A message with a label that is
+ *  not empty and not an object is never compressed.
+ */
+
+#ifndef ZIO_CODEC_HPP_SEEN
+#define ZIO_CODEC_HPP_SEEN
+
+#include "zio/message.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace zio {
+
+    namespace codec {
+
+        // The label object key holding the compression record,
+        // "zio.codec".
+        extern const char* key;
+
+        /*!
+         * @brief a compression algorithm
+         *
+         * Implementations must be safe to call from multiple threads.
+         */
+        class Codec
+        {
+          public:
+            virtual ~Codec() {}
+
+            /// The name recorded in the label.
+            virtual std::string name() const = 0;
+
+            /// Largest compressed size of size bytes of input.
+            virtual size_t bound(size_t size) const = 0;
+
+            /// Largest ratio of original to compressed size.  A
+            /// record claiming more is rejected before allocating.
+            virtual size_t expansion() const { return 1032; }
+
+            /// Compress into out which holds at least bound(size)
+            /// bytes.  Return the compressed size.
+            virtual size_t compress(const void* data, size_t size,
+                                    void* out) const = 0;
+
+            /// Decompress into out which holds exactly the original
+            /// out_size bytes.  Throw std::runtime_error on failure.
+            virtual void decompress(const void* data, size_t size, void* out,
+                                    size_t out_size) const = 0;
+        };
+        typedef std::shared_ptr<Codec> codecptr_t;
+
+        /// Register a codec, replacing any of the same name.  This
+        /// may be called while ports on other threads are in use.
+        void add(codecptr_t codec);
+
+        /// Return the named codec or nullptr if unknown.  The
+        /// builtins that were available at build time are any of
+        /// "zlib", "lz4" and "zstd".
+        codecptr_t get(const std::string& name);
+
+        /// Names of all known codecs.
+        std::vector<std::string> names();
+
+        /// Compress payload parts, those following the two headers,
+        /// of at least threshold bytes in place.  A part that does
+        /// not shrink is left as is.  Large parts are spread over up
+        /// to nthreads threads, the caller's and those of a pool
+        /// kept for the life of the process.  Return true if any
+        /// part was compressed.
+        bool compress(multipart_t& mmsg, const Codec& codec,
+                      size_t threshold = 4096, size_t nthreads = 1);
+
+        /// As above on a message.
+        bool compress(Message& msg, const Codec& codec,
+                      size_t threshold = 4096, size_t nthreads = 1);
+
+        /// Decompress in place a multipart message compressed as
+        /// above, restoring its original label.  Return false if the
+        /// message was not compressed.  Throw std::runtime_error if
+        /// the codec is unknown, the record is malformed, a part
+        /// would exceed the codec expansion() or the data is
+        /// corrupt.
+        bool decompress(multipart_t& mmsg);
+
+        /// As above on a message.
+        bool decompress(Message& msg);
+
+    }  // namespace codec
+}  // namespace zio
+
+#endif
@@ -32,26 +32,70 @@ namespace zio {
         enum class direction_e : int { unknown, inject, extract };
         enum class msgtype_e : int { unknown, bot, dat, pay, eot };
 
+        /*!
+         * @brief parameters to size the credit window at run time.
+         *
+         * A taker counts out windows of DAT received with get().  If
+         * get() found no DAT waiting at any time during a window,
+         * the window grows by increase.  Otherwise it shrinks by the
+         * decrease factor but not below the consumer's bandwidth
+         * delay product, the rate the application calls get() times
+         * the measured PAY to DAT round trip time.  The new window
+         * is signalled to the giver in the next PAY.
+         */
+        struct AdaptiveCredit
+        {
+            int min_credit{1};
+            int max_credit{1000};  // at most 65535
+            int increase{1};
+            double decrease{0.5};
+        };
+
+        /// Statistics on the credit window of a flow.
+        struct CreditStats
+        {
+            int window{0};  // current total credit
+            int min_window{0};
+            int max_window{0};
+            size_t grows{0};
+            size_t shrinks{0};
+            size_t starved{0};  // get() calls finding no DAT waiting
+            double rtt{0};      // seconds, smoothed PAY to DAT time
+            double drain{0};    // Hz, smoothed rate of calls to get()
+        };
+
+        /*!
+         * @brief access the flow attributes of a message.
+         *
+         * The message type, direction and credit are held in the
+         * binary flow fields of the message (see zio::FlowHeader) so
+         * reading them costs a few byte loads and the label is left
+         * for application data.  Messages from older peers which
+         * hold these as attributes of the label object are also
+         * read.  Setting any attribute of such a message moves them
+         * all to the binary fields.
+         */
         class Label
         {
             zio::Message& m_msg;
-            zio::json m_fobj;
-            bool m_dirty{false};
+
+            zio::FlowHeader& fields();
 
           public:
             Label(zio::Message& msg);
-            ~Label();
             Label(Label&& rhs) = default;
             Label& operator=(Label&& rhs) = default;
 
-            zio::json object() const { return m_fobj; }
-            zio::json& object() { return m_fobj; }
+            /// The label object holding any application attributes.
+            const zio::json& object() const { return m_msg.label_object(); }
+            zio::json& object() { return m_msg.label_object_ref(); }
 
             /// Emit a string rep
             std::string str() const;
 
-            /// Commit any changes back to the message
-            void commit();
+            /// Changes are made directly on the message.  This is
+            /// retained for compatibility and does nothing.
+            void commit() {}
 
             /// Return the direction of flow
             direction_e direction() const;
@@ -59,17 +103,25 @@ namespace zio {
             /// Return amount of credit in message or -1 if none/error
             int credit() const;
 
+            /// Return the new credit window carried by a PAY or 0 if
+            /// unchanged.
+            int window() const;
+
             /// Return the flow message type
             msgtype_e msgtype() const;
 
             /// Set direction
             void direction(direction_e);
 
-            /// Set the message type
+            /// Set the message type.  Setting unknown clears only
+            /// the type, other attributes are kept.
             void msgtype(msgtype_e mt);
 
             /// Set the amount of credit
             void credit(int cred);
+
+            /// Set the credit window, 0 if unchanged.
+            void window(int win);
         };
 
     }  // namespace flow
@@ -113,6 +165,14 @@ namespace zio {
         /// Return the amount of total credit in use
         int total_credit() const;
 
+        /// Let a taker size its credit window at run time within the
+        /// given bounds.  This may be called before or after bot().
+        /// A giver follows the window of its taker regardless.
+        void set_adaptive(const flow::AdaptiveCredit& adapt);
+
+        /// Return statistics on the credit window.
+        flow::CreditStats credit_stats() const;
+
         // client/server: do the bot handshake when the application
         // cares about the message content.  The payload of the passed
         // in message will be sent either as the initial client or as
@@ -123,7 +183,8 @@ namespace zio {
         // the BOT message content.
         bool bot();
 
-        /// Acknowledge an EOT received from other end.
+        /// Acknowledge an EOT received from other end.  This may
+        /// also begin an EOT handshake without waiting, see ready().
         bool eotack();
         bool eotack(zio::Message& eotmsg);
 
@@ -137,6 +198,34 @@ namespace zio {
         /// Attempt to get DAT (for takers) after flushing PAY.
         bool get(zio::Message& dat);
 
+        /// As put() but never wait.  Return false if there is no
+        /// credit.  May throw end_of_transmission.
+        bool try_put(zio::Message& dat);
+
+        /// As get() but never wait.  Return false if no DAT has
+        /// arrived.  May throw end_of_transmission.
+        bool try_get(zio::Message& dat);
+
+        /// @brief Return the readiness of the flow.
+        ///
+        /// Any messages waiting on the port are processed without
+        /// blocking.  The result has pollout if a giver may
+        /// try_put() and pollin if a DAT is held for try_get() or an
+        /// EOT was received.  A taker pays credit here once every
+        /// DAT received has been taken.
+        ///
+        /// To drive many flows from one thread, add each socket()
+        /// to a zio::poller_t for pollin and wait on it only when no
+        /// flow is ready.  The socket signals the arrival of PAY, DAT
+        /// and EOT; credit already held and DAT already received
+        /// are known only from ready().  To end a flow without
+        /// waiting, send EOT with eotack().  The reply EOT then
+        /// shows as pollin and try_put()/try_get() will throw.
+        zio::event_flags ready();
+
+        /// The socket of the flow's port, to add to a poller.
+        zio::socket_t& socket();
+
         /// Return the amount of credit in this flow object.
         ///
         /// This must be called if application uses low-level
@@ -193,6 +282,93 @@ namespace zio {
         std::unique_ptr<FlowImp> imp;
     };
 
+    struct FlowServerImp;
+
+    /*!
+     * @brief serve many flows over one SERVER port.
+     *
+     * Each client connecting to the port runs the flow protocol with
+     * its own state machine, found by the routing ID of its
+     * messages.  The application calls poll() to receive and
+     * process messages and to learn which flows need attention,
+     * much as with poll(2).  No call other than poll() waits for
+     * messages.  This is the C++ counterpart of the Python
+     * zio.flow.Broker loop.
+     */
+    class FlowServer
+    {
+      public:
+        /// Bit flags of an Event.
+        enum event_e : int {
+            botready = 1,   // a BOT awaits accept() or reject()
+            readable = 2,   // a DAT awaits get()
+            writable = 4,   // credit arrived to put() a DAT
+            eotready = 8,   // EOT received, eot() to acknowledge
+            ended = 16,     // the flow has ended and is forgotten
+        };
+        struct Event
+        {
+            remote_identity_t remid;
+            int events;
+        };
+
+        /// The port must be SERVER or ROUTER.  The credit is offered
+        /// to each client, which may only lower it.
+        FlowServer(zio::portptr_t port, int credit);
+        ~FlowServer();
+
+        /// Receive and process messages waiting up to timeout for the
+        /// first.  Fill events with the flows needing attention and
+        /// return their number.  Does not wait if any flow already
+        /// needs attention.
+        ///
+        /// All events but writable are reported for as long as they
+        /// hold.  Writable is reported once when a giving flow is
+        /// accepted and once each time credit arrives after, so that
+        /// an idle giver holding credit does not keep poll() from
+        /// waiting.  On writable, put() until it returns false or
+        /// there is nothing left to give.
+        size_t poll(std::vector<Event>& events, timeout_t timeout = {});
+
+        /// Number of flows, in any state.
+        size_t size() const;
+
+        /// The BOT message received to begin a flow.
+        const zio::Message& botmsg(const remote_identity_t& remid) const;
+
+        /// Complete the BOT handshake of a flow with a reply.  With
+        /// no reply the received BOT is sent back.  Return false if
+        /// the send timed out, in which case the flow is forgotten
+        /// as by reject().
+        bool accept(const remote_identity_t& remid);
+        bool accept(const remote_identity_t& remid, zio::Message& reply);
+
+        /// Forget a flow which sent a BOT.
+        void reject(const remote_identity_t& remid);
+
+        /// Return the direction of the server end of a flow.
+        flow::direction_e direction(const remote_identity_t& remid) const;
+
+        /// Return the credit held by the server end of a flow.
+        int credit(const remote_identity_t& remid) const;
+
+        /// Take a received DAT, return false if none.  Credit is paid
+        /// back to the client once all received DAT are taken.
+        bool get(const remote_identity_t& remid, zio::Message& dat);
+
+        /// Send a DAT if there is credit, return false if not.
+        bool put(const remote_identity_t& remid, zio::Message& dat);
+
+        /// Send EOT to end a flow, or to acknowledge one received.
+        /// The flow is forgotten when both ends have sent EOT and
+        /// the next poll() reports it as ended.
+        bool eot(const remote_identity_t& remid);
+        bool eot(const remote_identity_t& remid, zio::Message& msg);
+
+      private:
+        std::unique_ptr<FlowServerImp> imp;
+    };
+
 }  // namespace zio
 
 #endif
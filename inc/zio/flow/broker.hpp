@@ -0,0 +1,72 @@
+#ifndef ZIO_FLOW_BROKER_HPP_SEEN
+#define ZIO_FLOW_BROKER_HPP_SEEN
+
+#include "zio/flow.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+
+namespace zio {
+    namespace flow {
+
+        /*!
+         * @brief route flows between clients and their handlers.
+         *
+         * This is the C++ counterpart of the Python
+         * zio.flow.Broker and speaks the same protocol.  On a BOT
+         * from a new client the broker reverses its direction, adds
+         * a "cid" attribute holding the client's routing ID to the
+         * label object and calls the factory.  The factory starts a
+         * handler, in this process or another, which connects to
+         * the broker's port and begins a flow with that BOT, leaving
+         * "cid" intact.  The broker then pairs the two and sends
+         * each the BOT of the other.  All later messages are passed
+         * between the pair by routing ID alone without touching
+         * their label, though the SERVER socket still copies their
+         * payload once into its single frame.  The pair is
+         * forgotten after each has sent EOT.
+         */
+        class Broker
+        {
+          public:
+            /// Given the BOT for a handler, start the handler and
+            /// return true or return false to refuse the client.
+            /// The factory may move the BOT away.  It should return
+            /// promptly as the broker waits on it.
+            typedef std::function<bool(zio::Message& bot)> factory_t;
+
+            /// The port must be SERVER.
+            Broker(zio::portptr_t server, factory_t factory);
+
+            /// Route all messages waiting on the port, waiting up to
+            /// timeout for the first.  Return the number received, 0
+            /// on timeout.
+            size_t poll(timeout_t timeout = {});
+
+            /// Number of clients and handlers currently paired.
+            size_t size() const { return m_routes.size(); }
+
+          private:
+            void route(zio::Message& msg);
+            void from_client(zio::Message& msg);
+            void from_handler(zio::Message& msg, remote_identity_t cid);
+
+            zio::portptr_t m_port;
+            factory_t m_factory;
+
+            struct Route
+            {
+                remote_identity_t other;  // the paired endpoint
+                bool eot{false};          // this end has sent EOT
+            };
+            std::unordered_map<remote_identity_t, Route> m_routes;
+
+            // Clients whose BOT was accepted by the factory.
+            std::unordered_set<remote_identity_t> m_waiting;
+
+            std::vector<zio::Message> m_msgs;  // reused by poll()
+        };
+
+    }  // namespace flow
+}  // namespace zio
+#endif
@@ -8,8 +8,10 @@
 
 #include "zio/util.hpp"
 
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace zio {
 
@@ -29,6 +31,47 @@ namespace zio {
         const char* name(MessageLevel lvl);
     }  // namespace level
 
+    /*!
+     * @brief how a label object is encoded into the label string.
+     *
+     * A label holding a binary encoded object starts with a single
+     * reserved byte equal to the enum value followed by the encoded
+     * object.  No JSON text may start with these bytes.
+     */
+    enum class label_encoding_e : uint8_t { json = 0, cbor = 1, msgpack = 2 };
+
+    /// Return the encoding used by the label string.
+    label_encoding_e label_encoding(const std::string_view& label);
+
+    /// Encode the object to a label string with the encoding.
+    std::string dump_label(const zio::json& lobj,
+                           label_encoding_e enc = label_encoding_e::json);
+
+    /// Decode a label string to an object.  A null object is returned
+    /// if the label is empty or can not be decoded.
+    zio::json load_label(const std::string_view& label);
+
+    /*!
+     * @brief a non-owning view of an encoded prefix header
+     *
+     * The form and label refer directly to the encoded data which
+     * must outlive the view.
+     */
+    struct PrefixHeaderView
+    {
+        level::MessageLevel level{level::undefined};
+        std::string_view form{};
+        std::string_view label{};
+
+        // Return false if data can not be parsed as a prefix header.
+        // This does not allocate.
+        bool loads(const void* data, size_t size);
+        bool loads(const message_t& part)
+        {
+            return loads(part.data(), part.size());
+        }
+    };
+
     struct PrefixHeader
     {
         level::MessageLevel level{level::undefined};
@@ -38,6 +81,20 @@ namespace zio {
         std::string dumps() const;
         // Return false if s can not be parsed as a prefix header
         bool loads(const std::string& s);
+
+        // Set self from a view, reusing existing string capacity.
+        void loads(const PrefixHeaderView& view);
+
+        // The number of bytes the encoded prefix header requires.
+        size_t size() const { return 8 + label.size(); }
+
+        // Encode into buf which must hold at least size() bytes.
+        // Return the number of bytes written.
+        size_t dump(void* buf) const;
+
+        // Encode into the part, reusing its memory if it already
+        // has the exact size required.
+        void dump(message_t& part) const;
     };
 
     typedef uint64_t origin_t;
@@ -50,10 +107,33 @@ namespace zio {
         granule_t granule{0};
         seqno_t seqno{0};
     };
+    /*!
+     * @brief the binary flow control fields of a FLOW message
+     *
+     * When any field is set these follow the coord header in
+     * the same part so flow messages are classified without parsing
+     * the label.  See zio::flow::Label.
+     */
+    struct FlowHeader
+    {
+        uint8_t msgtype{0};    // zio::flow::msgtype_e, 0 if unknown
+        uint8_t direction{0};  // zio::flow::direction_e
+        uint16_t window{0};    // PAY: new total credit, 0 if unchanged
+        int32_t credit{-1};    // -1 if none
+
+        // Absent, and not sent, only if no field is set.
+        bool empty() const
+        {
+            return msgtype == 0 and direction == 0 and window == 0 and
+                   credit == -1;
+        }
+    };
+
     struct Header
     {
         PrefixHeader prefix;
         CoordHeader coord;
+        FlowHeader flow{};
     };
 
     /*!
@@ -64,6 +144,9 @@ namespace zio {
      * First part holds the prefix header, second the coord header.
      * Optional following parts are payload.
      *
+     * A message is not thread safe.  Even its const methods may
+     * update the cached label object so a message shared between
+     * threads must be guarded by the caller.
      */
     class Message
     {
@@ -85,11 +168,32 @@ namespace zio {
         std::string label() const;
         void set_label(const std::string& label);
 
-        /// Helper, when label holds a JSON object
-        zio::json label_object() const;
+        /// Helper, when label holds a JSON object.  The label is
+        /// parsed at most once and the result is cached until the
+        /// label is next set.  A null object is returned if the
+        /// label is empty or not JSON.
+        const zio::json& label_object() const;
+
+        /// Mutable access to the cached label object.  The label
+        /// string is only re-serialized when it is next needed (eg,
+        /// when the message is sent).  Throw std::runtime_error if
+        /// the label is not empty and can not be decoded, rather
+        /// than later overwrite it.
+        zio::json& label_object_ref();
+
+        /// Set the label object.  As above, serialization is
+        /// deferred.
         void set_label_object(const zio::json& lobj);
+        void set_label_object(zio::json&& lobj);
 
-        const PrefixHeader& prefix() const { return m_header.prefix; }
+        /// The encoding that a label object is serialized with.  By
+        /// default, this is JSON text.  Setting a new encoding
+        /// re-encodes any label that holds an object.  A label that
+        /// is not an object (eg, plain text) is left as-is.
+        label_encoding_e label_encoding() const { return m_label_encoding; }
+        void set_label_encoding(label_encoding_e enc);
+
+        const PrefixHeader& prefix() const;
         const CoordHeader& coord() const { return m_header.coord; }
         origin_t origin() const { return m_header.coord.origin; }
         granule_t granule() const { return m_header.coord.granule; }
@@ -102,6 +206,11 @@ namespace zio {
         /// Explicit set
         void set_seqno(int seqno) { m_header.coord.seqno = seqno; }
 
+        /// The binary flow fields.  These are normally accessed via
+        /// zio::flow::Label.
+        const FlowHeader& flow() const { return m_header.flow; }
+        FlowHeader& flow() { return m_header.flow; }
+
         /// Encode self to single-part message.  If self has a remote
         /// identity, it will be set as a routing ID on the produced
         /// message.
@@ -112,26 +221,143 @@ namespace zio {
         /// identity.
         void decode(const message_t& dat);
 
+        /// As above but large payload parts will reference the
+        /// memory of the encoded message instead of being copied.
+        void decode(message_t&& dat);
+
         /// Set self from multipart.  Nullifyies routing ID
         void fromparts(const multipart_t& allparts);
 
-        /// Serialize self to multipart
-        multipart_t toparts() const;
+        /// Set self from multipart, adopting the payload parts
+        /// without copying their data.  Nullifyies routing ID
+        void fromparts(multipart_t&& allparts);
+
+        /// Serialize self to multipart.  Payload data is copied.
+        multipart_t toparts() const&;
+
+        /// Serialize self to multipart, moving the payload parts
+        /// into the result without copying their data.  Self is left
+        /// with an empty payload.
+        multipart_t toparts() &&;
+
+        /// As above but into parts, which is first cleared, so that
+        /// a container kept by the caller is reused.
+        void toparts(multipart_t& parts) const&;
+        void toparts(multipart_t& parts) &&;
+
+        /// Reset self to a default message.  Memory held for the
+        /// label string and the payload container is kept for reuse.
+        void clear();
 
         /// Access payload(s)
-        const multipart_t& payload() const { return m_payload; }
-        void clear_payload() { m_payload.clear(); }
-        void add(message_t&& spmsg) { m_payload.add(std::move(spmsg)); }
+        const multipart_t& payload() const;
+        void clear_payload()
+        {
+            if (m_payload) { m_payload->clear(); }
+        }
+        void add(message_t&& spmsg) { parts().add(std::move(spmsg)); }
+
+        /// Add a payload part referencing externally owned data
+        /// without copying.  See @ref zio::shared_message.
+        void add(const void* data, size_t size,
+                 std::shared_ptr<const void> owner)
+        {
+            parts().add(shared_message(data, size, std::move(owner)));
+        }
 
         remote_identity_t remote_id() const { return m_remid; }
         void set_remote_id(remote_identity_t remid) { m_remid = remid; }
 
       private:
-        header_t m_header;
-        multipart_t m_payload;
+        void load_headers(const multipart_t& allparts);
+        void label_changed();
+        multipart_t& parts();  // the payload, made on first use
+
+        // The label string and its parsed object are kept lazily in
+        // sync, thus mutable.
+        mutable header_t m_header;
+        mutable zio::json m_lobj;
+        mutable bool m_lobj_valid{false};  // m_lobj reflects the label
+        mutable bool m_label_dirty{false};  // label must be made from m_lobj
+        label_encoding_e m_label_encoding{label_encoding_e::json};
+
+        // Held by pointer as moving a multipart_t allocates, which
+        // would defeat a MessagePool.  Null until first needed.
+        std::unique_ptr<multipart_t> m_payload;
         remote_identity_t m_remid;
     };
 
+    /*!
+     * @brief a message header serialized once for repeated sends
+     *
+     * When many messages share form, level and label only their
+     * coordinates need to change.  The prefix header is encoded once
+     * on construction and each toparts() only patches the coord
+     * header, advancing the seqno.
+     */
+    class HeaderTemplate
+    {
+      public:
+        /// The first message produced will have the seqno of coord.
+        HeaderTemplate(const PrefixHeader& prefix,
+                       const CoordHeader& coord = CoordHeader{});
+
+        /// Take prefix, coord and flow fields from the message.
+        explicit HeaderTemplate(const Message& msg);
+
+        /// Return the parts of the next message with the payload.
+        /// If granule is 0 the current time is used.
+        multipart_t toparts(multipart_t&& payload, granule_t gran = 0);
+
+        /// The coord header that the next message will carry.
+        CoordHeader& coord() { return m_coord; }
+        const CoordHeader& coord() const { return m_coord; }
+
+        /// The flow fields that each message will carry.
+        FlowHeader& flow() { return m_flow; }
+        const FlowHeader& flow() const { return m_flow; }
+
+      private:
+        std::string m_prefix;  // encoded
+        CoordHeader m_coord;
+        FlowHeader m_flow;
+    };
+
+    /*!
+     * @brief recycle messages to avoid steady-state allocation
+     *
+     * A message released to the pool is cleared but keeps its label
+     * string capacity and its payload container.  A later acquire()
+     * hands it back out so that a send/recv loop need not allocate
+     * for these after warm-up.  A pool is not thread safe, use one
+     * per port or per thread.
+     */
+    class MessagePool
+    {
+      public:
+        /// Keep at most max_size idle messages.
+        explicit MessagePool(size_t max_size = 16);
+
+        /// Return a cleared message, recycled if one is available.
+        Message acquire();
+
+        /// As above, with the form and level set.
+        Message acquire(const std::string& form,
+                        level::MessageLevel lvl = level::undefined);
+
+        /// Give a message back to the pool.  It is dropped if the
+        /// pool is full.
+        void release(Message&& msg);
+
+        /// Number of idle messages held.
+        size_t size() const { return m_idle.size(); }
+        size_t max_size() const { return m_max_size; }
+
+      private:
+        size_t m_max_size;
+        std::vector<Message> m_idle;
+    };
+
 }  // namespace zio
 
 #endif
@@ -3,8 +3,10 @@
 
 #include "zio/peer.hpp"
 #include "zio/message.hpp"
+#include "zio/codec.hpp"
 #include "zio/util.hpp"
 
+#include <chrono>
 #include <memory>
 #include <map>
 
@@ -111,20 +113,121 @@ namespace zio {
         /// This method is intended for the @ref zio::Node to call
         void offline();
 
+        /// @brief Set the label encoding for sent messages.
+        ///
+        /// When set, any label object of a message sent by this port
+        /// is encoded thus (see @ref zio::label_encoding_e).  The
+        /// receiving end detects the encoding automatically.
+        void set_label_encoding(label_encoding_e enc)
+        {
+            m_label_encoding = enc;
+        }
+
+        /// @brief Compress large payload parts of sent messages.
+        ///
+        /// Parts of at least threshold bytes are compressed with the
+        /// named codec (see @ref zio::codec), spread over up to
+        /// nthreads threads.  A message already compressed is sent
+        /// as-is.  Any receiving port decompresses transparently.  An
+        /// empty name turns compression off.  Throw
+        /// std::runtime_error if the codec is unknown.
+        void set_compression(const std::string& codec,
+                             size_t threshold = 4096, size_t nthreads = 1);
+
+        /// @brief Pack small messages into batches.
+        ///
+        /// A sent message is held until max_count messages or
+        /// max_bytes of their encoding are held, or until linger has
+        /// passed since the first was held.  The held messages are
+        /// then sent together as a single transport frame.  Each
+        /// keeps its own headers.  A max_count less than two turns
+        /// batching off.  A receiving port always unpacks batches.
+        ///
+        /// There is no background timer.  The linger is checked by
+        /// send() and recv() and a recv() which may wait flushes any
+        /// held messages.  Otherwise call flush().
+        void set_batching(size_t max_count, size_t max_bytes = 65536,
+                          std::chrono::milliseconds linger =
+                              std::chrono::milliseconds(1));
+
+        /// @brief Align tensor data of received messages.
+        ///
+        /// Received TENS data which is not aligned to alignment
+        /// bytes is copied to aligned buffers (see @ref
+        /// zio::tens::align).  The copies are logged at debug level
+        /// and counted by zio::tens::align_stats().  Zero turns
+        /// this off.
+        void set_tensor_alignment(size_t alignment)
+        {
+            m_tensor_alignment = alignment;
+        }
+
+        /// @brief Send any messages held for batching.
+        ///
+        /// Return false if there were none.
+        bool flush();
+
         /// @brief Send a message.
         ///
         /// The @ref zio::Message is modified to set its coordinates.
         bool send(Message& msg, timeout_t timeout = {});
 
+        /// @brief Send a message, handing its payload to the socket.
+        ///
+        /// As above but the message gives up its payload parts.  On
+        /// multipart socket types (eg DEALER, ROUTER, PAIR) they are
+        /// moved to the socket without copying their data.  CLIENT
+        /// and SERVER sockets carry a single frame so the parts are
+        /// still copied once into its encoding.  Either way the
+        /// message is left with an empty payload.
+        bool send(Message&& msg, timeout_t timeout = {});
+
+        /// @brief Send payload with a prepared header.
+        ///
+        /// This avoids serializing the same prefix header for every
+        /// message.  The coord header of the template is advanced
+        /// and given this port's origin, if set.  The remote
+        /// identity is required for a SERVER or ROUTER port.
+        bool send(HeaderTemplate& head, multipart_t&& payload,
+                  const remote_identity_t& remid = "");
+
         /// Recieve a message, return false if timeout occurred.
+        ///
+        /// The message is overwritten.  Passing a message obtained
+        /// from pool() lets its memory be reused.
         bool recv(Message& msg, timeout_t timeout = {});
 
+        /// @brief Receive all messages already queued, up to max.
+        ///
+        /// The first message is waited for as with recv().  Any more
+        /// are taken only if already available, without further
+        /// polling.  Messages are decoded into the front of msgs,
+        /// reusing its elements, and the number received is
+        /// returned.  The vector is grown as needed but never
+        /// shrunk so elements past the count are stale.
+        size_t recv_many(std::vector<Message>& msgs, size_t max,
+                         timeout_t timeout = {});
+
+        /// @brief Access the pool of messages to recycle.
+        ///
+        /// Code sending or receiving on this port may acquire()
+        /// messages from the pool and release() them when done.
+        MessagePool& pool() { return m_pool; }
+
         /// @brief Access the underlying cppzmq socket.
         ///
         /// This access is generally not recomended.
         zio::socket_t& socket() { return m_sock; }
 
       private:
+        bool send_parts(multipart_t& mmsg, const remote_identity_t& remid);
+        bool send_prepared(const remote_identity_t& remid);
+        void compress(multipart_t& mmsg);
+        bool send_batched(message_t&& encoded, const remote_identity_t& remid);
+        bool recv_batched(Message& msg);
+        bool recv_now(Message& msg, recv_flags flags);
+        void align(Message& msg);
+
         const std::string m_name;
         zio::context_t m_ctx;
         zio::socket_t m_sock;
@@ -141,6 +244,28 @@ namespace zio {
         std::vector<std::pair<nodename_t, portname_t> > m_connect_nodeports;
 
         bool m_verbose{false};
+        std::optional<label_encoding_e> m_label_encoding;
+
+        MessagePool m_pool;
+        // Reused so that sending and receiving do not allocate.
+        multipart_t m_send_parts, m_recv_parts;
+
+        // Compression on send.
+        codec::codecptr_t m_codec;
+        size_t m_codec_threshold{0}, m_codec_nthreads{1};
+        size_t m_tensor_alignment{0};
+
+        // Batching on send, held messages are in their encoded form.
+        size_t m_batch_count{0}, m_batch_bytes{0};
+        std::chrono::milliseconds m_batch_linger{0};
+        multipart_t m_batch;
+        size_t m_batch_held_bytes{0};
+        remote_identity_t m_batch_remid;
+        std::chrono::steady_clock::time_point m_batch_start;
+
+        // Messages from a received batch not yet returned by recv().
+        multipart_t m_unbatched;
+        remote_identity_t m_unbatched_remid;
     };
 
     /// The context can't be copied and ports like to be shared.
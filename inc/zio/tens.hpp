@@ -7,6 +7,14 @@
 
 #include "zio/message.hpp"
 
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+
 namespace zio {
 
     namespace tens {
@@ -14,19 +22,127 @@ namespace zio {
         // The default message "form" (which is "TENS"), if none is set.
         extern const char* form;
 
+        // The default alignment, in bytes, made by align() and a
+        // packed Builder.  This suits aligned loads of the widest
+        // common SIMD registers.
+        const size_t default_alignment = 64;
+
+        /*! Return the dtype kind character of a type at run time.
+         *
+         * This is the form written by older versions.  Prefer the
+         * compile time dtype_traits.
+         */
         const char* type_name(const std::type_info& t);
 
         template <typename Type>
-        const char* dtype()
+        struct is_complex : std::false_type
+        {
+        };
+        template <typename Type>
+        struct is_complex<std::complex<Type>> : std::true_type
+        {
+        };
+
+        // Return the numpy dtype kind character of a type.
+        template <typename Type>
+        constexpr char dtype_kind()
+        {
+            if constexpr (std::is_same_v<Type, bool>) { return 'b'; }
+            else if constexpr (std::is_floating_point_v<Type>) { return 'f'; }
+            else if constexpr (is_complex<Type>::value) { return 'c'; }
+            else if constexpr (std::is_integral_v<Type>) {
+                return std::is_signed_v<Type> ? 'i' : 'u';
+            }
+            return 'V';
+        }
+
+        // Return a numpy dtype code, eg "<f4", null terminated.
+        constexpr std::array<char, 8> dtype_code(char order, char kind,
+                                                 size_t word)
+        {
+            std::array<char, 8> code{};
+            size_t num = 0;
+            code[num++] = order;
+            code[num++] = kind;
+            size_t div = 1;
+            while (div * 10 <= word) { div *= 10; }
+            for (; div and num < 7; div /= 10) {
+                code[num++] = char('0' + word / div % 10);
+            }
+            return code;
+        }
+
+        /*! Compile time description of an element type.
+         *
+         * The code is that of a numpy dtype, eg "<f4", "<i2" or
+         * "<c8", giving byte order, kind and size.  Types which are
+         * not numbers are raw bytes, eg "|V12".
+         */
+        template <typename Type>
+        struct dtype_traits
         {
-            return type_name(typeid(Type));
+            static constexpr size_t word = sizeof(Type);
+
+            static constexpr char kind = dtype_kind<Type>();
+
+            static constexpr char order =
+                (word == 1 or kind == 'V')
+                    ? '|'
+                    : (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? '>' : '<');
+
+            static constexpr std::array<char, 8> code_array =
+                dtype_code(order, kind, word);
+            static constexpr const char* code = code_array.data();
+        };
+
+        /// Return the numpy dtype code of the type.
+        template <typename Type>
+        constexpr const char* dtype()
+        {
+            return dtype_traits<Type>::code;
         }
 
+        /*! Return true if a tensor description matches the element.
+         *
+         * The described dtype may be a numpy code or, as written by
+         * older versions, only the kind character.  The element is
+         * given by its code and word size.
+         */
+        bool dtype_matches(const std::string& dtype, size_t word,
+                           const char* code, size_t code_word);
+
+        template <typename ElementType>
+        bool dtype_matches(const std::string& dtype, size_t word)
+        {
+            typedef dtype_traits<ElementType> traits;
+            if (word != traits::word) { return false; }
+            if (dtype == traits::code) { return true; }
+            return dtype_matches(dtype, word, traits::code, traits::word);
+        }
+
+        /*! Add a CRC-32C checksum of the data of each dense tensor
+         * appended to this message after this call, including by a
+         * @ref Builder made after.  Off by default.  The choice is
+         * kept in the label so each producer decides for itself.
+         *
+         * Checksums are verified by at().  See TensorRef::verify().
+         */
+        void set_checksums(Message& msg, bool on = true);
+        bool checksums(const Message& msg);
+
         /*! Generic version of append. */
         void append(Message& msg, message_t&& data,
                     const std::vector<size_t>& shape, size_t word_size,
                     const char* tn, const zio::json& md = zio::json{});
 
+        /*! Generic version of append which copies nbytes of data.
+         *
+         * Any checksum is computed during the copy.
+         */
+        void append_copy(Message& msg, const void* data, size_t nbytes,
+                         const std::vector<size_t>& shape, size_t word_size,
+                         const char* tn, const zio::json& md = zio::json{});
+
         /*! Append one array data of given shape to message.
          *
          * - shape :: number of elements in each dimension.
@@ -41,19 +157,244 @@ namespace zio {
             size_t nbytes = sizeof(ElementType);
             size_t word = nbytes;
             for (auto s : shape) { nbytes *= s; }
-            append(msg, zio::message_t((const void*)data, nbytes), shape, word,
-                   type_name(typeid(ElementType)), md);
+            append_copy(msg, data, nbytes, shape, word, dtype<ElementType>(),
+                        md);
+        }
+
+        /*! Append one array of externally owned data to message.
+         *
+         * - owner :: keeps data alive until libzmq is done with it.
+         *
+         * No copy of data is made.  It must not be modified until
+         * the owner is released which may be after the message is
+         * sent.  Typically the owner is the shared_ptr holding data
+         * or one holding a ring buffer slot that contains it.
+         */
+        template <typename ElementType>
+        void append(Message& msg, const ElementType* data,
+                    const std::vector<size_t>& shape,
+                    std::shared_ptr<const void> owner,
+                    const zio::json& md = zio::json{})
+        {
+            size_t nbytes = sizeof(ElementType);
+            size_t word = nbytes;
+            for (auto s : shape) { nbytes *= s; }
+            append(msg, zio::shared_message(data, nbytes, std::move(owner)),
+                   shape, word, dtype<ElementType>(), md);
+        }
+
+        /*! Generic version of append_strided(). */
+        void append_strided(Message& msg, const void* data,
+                            const std::vector<size_t>& shape,
+                            const std::vector<size_t>& strides,
+                            size_t word_size, const char* tn,
+                            const zio::json& md = zio::json{});
+
+        /*! Append a copy of an array of any memory layout.
+         *
+         * - strides :: distance, in elements, between consecutive
+         *   indices of each dimension of the source.
+         *
+         * This allows a slice of a larger array or a Fortran order
+         * matrix to be sent without an intermediate copy.  A source
+         * which is contiguous in C or Fortran order is copied as-is
+         * and described with its "order".  Otherwise its elements are
+         * gathered in C order directly into the message part.
+         */
+        template <typename ElementType>
+        void append_strided(Message& msg, const ElementType* data,
+                            const std::vector<size_t>& shape,
+                            const std::vector<size_t>& strides,
+                            const zio::json& md = zio::json{})
+        {
+            append_strided(msg, (const void*)data, shape, strides,
+                           sizeof(ElementType), dtype<ElementType>(), md);
+        }
+
+        /*! Generic version of sparse append.
+         *
+         * - packing :: "coo" or "csr".
+         * - values :: nnz non-zero elements.
+         * - indices :: for "coo", rank arrays of nnz coordinates, one
+         *   array per dimension.  For "csr", nnz column indices.
+         * - indptr :: for "csr", shape[0]+1 offsets into values, one
+         *   per row.  Empty for "coo".
+         * - index_word :: size in bytes of one unsigned index.
+         *
+         * Each of values, indices and indptr becomes a payload part.
+         * Throw std::runtime_error if the sizes are inconsistent.
+         */
+        void append_sparse(Message& msg, const std::string& packing,
+                           message_t&& values, message_t&& indices,
+                           message_t&& indptr, size_t nnz,
+                           const std::vector<size_t>& shape, size_t word_size,
+                           const char* tn, size_t index_word,
+                           const zio::json& md = zio::json{});
+
+        /*! Append a copy of a sparse array in coordinate format.
+         *
+         * - indices :: rank arrays of nnz coordinates, the first
+         *   array holding all coordinates for dimension 0, etc.
+         */
+        template <typename ElementType, typename IndexType>
+        void append_coo(Message& msg, const ElementType* values,
+                        const IndexType* indices, size_t nnz,
+                        const std::vector<size_t>& shape,
+                        const zio::json& md = zio::json{})
+        {
+            static_assert(std::is_unsigned_v<IndexType>,
+                          "sparse indices must be unsigned");
+            const size_t nind = nnz * shape.size();
+            append_sparse(msg, "coo",
+                          zio::message_t(values, nnz * sizeof(ElementType)),
+                          zio::message_t(indices, nind * sizeof(IndexType)),
+                          zio::message_t(), nnz, shape, sizeof(ElementType),
+                          dtype<ElementType>(), sizeof(IndexType),
+                          md);
+        }
+
+        /*! Append a copy of a sparse matrix in compressed sparse row
+         * format.
+         *
+         * - indptr :: shape[0]+1 offsets, row r has values in
+         *   [indptr[r], indptr[r+1]).
+         * - indices :: column index of each value.
+         */
+        template <typename ElementType, typename IndexType>
+        void append_csr(Message& msg, const ElementType* values,
+                        const IndexType* indptr, const IndexType* indices,
+                        const std::vector<size_t>& shape,
+                        const zio::json& md = zio::json{})
+        {
+            static_assert(std::is_unsigned_v<IndexType>,
+                          "sparse indices must be unsigned");
+            if (shape.size() != 2) {
+                throw std::runtime_error("tens: csr requires rank 2");
+            }
+            const size_t nnz = indptr[shape[0]];
+            append_sparse(
+                msg, "csr", zio::message_t(values, nnz * sizeof(ElementType)),
+                zio::message_t(indices, nnz * sizeof(IndexType)),
+                zio::message_t(indptr, (shape[0] + 1) * sizeof(IndexType)),
+                nnz, shape, sizeof(ElementType),
+                dtype<ElementType>(), sizeof(IndexType), md);
+        }
+
+        /*! Append the non-zero elements of a dense array as "coo".
+         *
+         * This is a convenience for zero-suppressed data.  Throw
+         * std::runtime_error if a dimension exceeds IndexType.
+         */
+        template <typename ElementType, typename IndexType = uint32_t>
+        void append_nonzero(Message& msg, const ElementType* dense,
+                            const std::vector<size_t>& shape,
+                            const zio::json& md = zio::json{})
+        {
+            static_assert(std::is_unsigned_v<IndexType>,
+                          "sparse indices must be unsigned");
+            size_t size = 1;
+            for (auto s : shape) {
+                if (s > (size_t)std::numeric_limits<IndexType>::max()) {
+                    throw std::runtime_error("tens: index type too small");
+                }
+                size *= s;
+            }
+            const ElementType zero{};
+            size_t nnz = 0;
+            for (size_t ind = 0; ind < size; ++ind) {
+                if (!(dense[ind] == zero)) { ++nnz; }
+            }
+            const size_t rank = shape.size();
+            zio::message_t values(nnz * sizeof(ElementType));
+            zio::message_t indices(rank * nnz * sizeof(IndexType));
+            ElementType* val = values.data<ElementType>();
+            IndexType* idx = indices.data<IndexType>();
+            std::vector<size_t> coord(rank, 0);
+            for (size_t ind = 0, nz = 0; ind < size; ++ind) {
+                if (!(dense[ind] == zero)) {
+                    val[nz] = dense[ind];
+                    for (size_t dim = 0; dim < rank; ++dim) {
+                        idx[dim * nnz + nz] = coord[dim];
+                    }
+                    ++nz;
+                }
+                // C order odometer
+                for (size_t dim = rank; dim > 0; --dim) {
+                    if (++coord[dim - 1] < shape[dim - 1]) { break; }
+                    coord[dim - 1] = 0;
+                }
+            }
+            append_sparse(msg, "coo", std::move(values), std::move(indices),
+                          zio::message_t(), nnz, shape, sizeof(ElementType),
+                          dtype<ElementType>(), sizeof(IndexType),
+                          md);
+        }
+
+        /*! Generic version of append_chunk(). */
+        void append_chunk(Message& msg, message_t&& data,
+                          const std::vector<size_t>& full_shape, size_t offset,
+                          size_t nrows, size_t word_size, const char* tn,
+                          const std::string& id,
+                          const zio::json& md = zio::json{});
+
+        /*! Append a copy of one chunk of a larger tensor.
+         *
+         * A tensor too large for one message may be sent as a
+         * sequence of chunks, each a slab of consecutive rows along
+         * dimension 0.  Each chunk is an ordinary dense tensor of
+         * shape full_shape with dimension 0 replaced by nrows.  Its
+         * description also gives the id of the whole tensor and the
+         * offset of the chunk so that a @ref Reassembler may put
+         * the whole back together.
+         *
+         * - data :: nrows of the tensor starting at row offset.
+         * - id :: identifies the whole tensor to the receiver.
+         */
+        template <typename ElementType>
+        void append_chunk(Message& msg, const ElementType* data, size_t nrows,
+                          size_t offset, const std::vector<size_t>& full_shape,
+                          const std::string& id,
+                          const zio::json& md = zio::json{})
+        {
+            size_t nbytes = sizeof(ElementType) * nrows;
+            for (size_t dim = 1; dim < full_shape.size(); ++dim) {
+                nbytes *= full_shape[dim];
+            }
+            append_chunk(msg, zio::message_t((const void*)data, nbytes),
+                         full_shape, offset, nrows, sizeof(ElementType),
+                         dtype<ElementType>(), id, md);
         }
 
         /*! Return the tensor at the given index.
          *
          * Index is into the label object TENS JSON array which may
-         * not be the message part index.
+         * not be the message part index.  For a sparse tensor this
+         * is the part holding its values.
+         *
+         * An empty message is returned on error, including when the
+         * data does not match its checksum or shares a packed frame
+         * with other tensors.
          *
-         * An empty message is returned on error.
+         * Each call parses the label or descriptor anew.  To visit
+         * many tensors of one message use a @ref Reader instead.
          */
         const zio::message_t& at(const Message& msg, size_t index);
 
+        /*! As above but also return an empty message if the tensor
+         * does not have the given dtype and word size.
+         */
+        const zio::message_t& at(const Message& msg, size_t index,
+                                 const std::string& dtype, size_t word);
+
+        /*! Return a pointer to the data of the tensor at the given
+         * index, or nullptr under the same conditions as the above.
+         *
+         * Unlike at(), this also finds tensors packed into a shared
+         * frame by a @ref Builder.
+         */
+        const void* at_data(const Message& msg, size_t index,
+                            const std::string& dtype, size_t word);
+
         /*! Return the tensor data at payload index in FORM message.
          *
          * This returns a pointer into the message data.
@@ -63,11 +404,617 @@ namespace zio {
         template <typename ElementType>
         const ElementType* at(const Message& msg, size_t index)
         {
-            const zio::message_t& ret = at(msg, index);
-            if (ret.empty()) { return nullptr; }
-            return (const ElementType*)ret.data();
+            return (const ElementType*)at_data(
+                msg, index, dtype<ElementType>(), sizeof(ElementType));
         }
 
+        /*! An untyped reference to one tensor in a message.
+         *
+         * The data points into the message payload which must
+         * outlive the reference.  A reference to a tensor that could
+         * not be resolved has null data.
+         */
+        struct TensorRef
+        {
+            const void* data{nullptr};
+            size_t nbytes{0};
+            std::string dtype{};
+            size_t word{0};
+            std::vector<size_t> shape{};
+            std::vector<size_t> strides{};  // in elements
+            size_t part{0};
+            size_t part_offset{0};  // bytes into part, if packed
+            zio::json metadata{};
+
+            // Sparse tensors only.  Data holds the nnz values.
+            std::string packing{};  // empty if dense, "coo" or "csr"
+            size_t nnz{0};
+            const void* indices{nullptr};
+            const void* indptr{nullptr};  // "csr" only
+            size_t index_word{0};
+
+            // Chunked tensors only.  Shape is that of the chunk.
+            std::string chunk{};  // id of the whole, empty if unchunked
+            size_t offset{0};     // of the chunk along dimension 0
+            size_t total{0};      // size of dimension 0 of the whole
+
+            bool has_checksum{false};
+            uint32_t checksum{0};  // CRC-32C of the data
+
+            // Quantized tensors only.  Data holds the stored elements.
+            std::string quant{};  // empty if not, "f16", "bf16" or "i16"
+            float quant_scale{1};  // "i16": element = stored*scale+offset
+            float quant_offset{0};
+
+            explicit operator bool() const { return data != nullptr; }
+
+            bool sparse() const { return !packing.empty(); }
+
+            bool quantized() const { return !quant.empty(); }
+
+            /// False if the data does not match its checksum.  This
+            /// reads all the data so a Reader leaves it to the caller.
+            bool verify() const;
+
+            /// Number of elements, including zeros if sparse.  This
+            /// is known not to overflow only if the ref is resolved.
+            size_t size() const;
+        };
+
+        /// Return C order strides, in elements, for the shape.
+        std::vector<size_t> c_strides(const std::vector<size_t>& shape);
+
+        /*! Return strides, in elements, for the shape stored in the
+         * given order.
+         *
+         * As with Boost multi_array, order[0] is the dimension which
+         * varies fastest.  C order is {rank-1, ..., 1, 0} and Fortran
+         * order is {0, 1, ..., rank-1}.  Return empty strides if the
+         * order is not a permutation of the dimensions.
+         */
+        std::vector<size_t> order_strides(const std::vector<size_t>& shape,
+                                          const std::vector<size_t>& order);
+
+        /// How a quantized tensor stores float elements in 16 bits.
+        enum class quant_e { f16, bf16, i16 };
+
+        struct Quantization
+        {
+            quant_e codec{quant_e::f16};
+            // For "i16" only, element = stored * scale + offset.  A
+            // zero scale is chosen to span the range of the finite
+            // data.  Infinities saturate and NaN decodes as offset.
+            float scale{0};
+            float offset{0};
+        };
+
+        /*! Append float data quantized to 16 bit elements.
+         *
+         * The stored elements are IEEE half precision ("f16"),
+         * bfloat16 ("bf16") or linearly scaled int16 ("i16").  The
+         * description gives their dtype and a "quant" object
+         * recording how to decode them.  Conversion is vectorized
+         * where the CPU allows.
+         */
+        void append_quantized(Message& msg, const float* data,
+                              const std::vector<size_t>& shape,
+                              const Quantization& quant,
+                              const zio::json& md = zio::json{});
+
+        /*! Decode a quantized tensor into out which must hold
+         * ref.size() floats.  Return false if the reference is not
+         * to a resolved, quantized tensor.
+         */
+        bool dequantize(const TensorRef& ref, float* out);
+
+        // Conversions of n elements to and from 16 bit floats, with
+        // round to nearest even.  F16C is used if the CPU has it.
+        void float_to_half(const float* in, uint16_t* out, size_t n);
+        void half_to_float(const uint16_t* in, float* out, size_t n);
+        void float_to_bfloat(const float* in, uint16_t* out, size_t n);
+        void bfloat_to_float(const uint16_t* in, float* out, size_t n);
+
+        /*! A typed, read-only view of tensor data.
+         *
+         * Elements are accessed in place, as with mdspan, via
+         * strides which are counted in elements.  A default
+         * constructed view is invalid.
+         */
+        template <typename ElementType>
+        class View
+        {
+            static_assert(std::is_trivially_copyable_v<ElementType>,
+                          "tensor elements must be trivially copyable");
+
+          public:
+            typedef ElementType element_type;
+
+            View() = default;
+            View(const ElementType* data, const std::vector<size_t>& shape,
+                 const std::vector<size_t>& strides)
+                : m_data(data)
+                , m_shape(shape)
+                , m_strides(strides)
+            {
+            }
+
+            explicit operator bool() const { return m_data != nullptr; }
+
+            const ElementType* data() const { return m_data; }
+            size_t rank() const { return m_shape.size(); }
+            const std::vector<size_t>& shape() const { return m_shape; }
+            const std::vector<size_t>& strides() const { return m_strides; }
+
+            /// Number of elements.
+            size_t size() const
+            {
+                size_t n = 1;
+                for (auto s : m_shape) { n *= s; }
+                return n;
+            }
+
+            /// Unchecked access, one index per dimension.
+            template <typename... Index>
+            const ElementType& operator()(Index... index) const
+            {
+                static_assert((std::is_integral_v<Index> && ...),
+                              "tensor indices must be integers");
+                const std::array<size_t, sizeof...(Index)> idx{
+                    static_cast<size_t>(index)...};
+                size_t off = 0;
+                for (size_t dim = 0; dim < idx.size(); ++dim) {
+                    off += idx[dim] * m_strides[dim];
+                }
+                return m_data[off];
+            }
+
+            /// Checked access, throws std::out_of_range.
+            const ElementType& at(const std::vector<size_t>& index) const
+            {
+                if (!m_data or index.size() != m_shape.size()) {
+                    throw std::out_of_range("tensor view: bad rank");
+                }
+                size_t off = 0;
+                for (size_t dim = 0; dim < index.size(); ++dim) {
+                    if (index[dim] >= m_shape[dim]) {
+                        throw std::out_of_range("tensor view: bad index");
+                    }
+                    off += index[dim] * m_strides[dim];
+                }
+                return m_data[off];
+            }
+
+          private:
+            const ElementType* m_data{nullptr};
+            std::vector<size_t> m_shape{};
+            std::vector<size_t> m_strides{};
+        };
+
+        /*! A typed, read-only view of a sparse tensor.
+         *
+         * Values and indices are accessed in place.  Iteration is in
+         * blocks of C order element offsets paired with values so
+         * the inner loops run over contiguous arrays and may be
+         * vectorized by the compiler.  A default constructed view
+         * is invalid.
+         */
+        template <typename ElementType, typename IndexType = uint32_t>
+        class SparseView
+        {
+            static_assert(std::is_trivially_copyable_v<ElementType>,
+                          "tensor elements must be trivially copyable");
+            static_assert(std::is_unsigned_v<IndexType>,
+                          "sparse indices must be unsigned");
+
+          public:
+            typedef ElementType element_type;
+            typedef IndexType index_type;
+
+            /// Maximum number of elements given to a block function.
+            static constexpr size_t block_size = 256;
+
+            SparseView() = default;
+            explicit SparseView(const TensorRef& ref)
+                : m_values((const ElementType*)ref.data)
+                , m_indices((const IndexType*)ref.indices)
+                , m_indptr((const IndexType*)ref.indptr)
+                , m_nnz(ref.nnz)
+                , m_csr(ref.packing == "csr")
+                , m_shape(ref.shape)
+                , m_strides(ref.strides)
+            {
+            }
+
+            explicit operator bool() const { return m_values != nullptr; }
+
+            bool csr() const { return m_csr; }
+            size_t rank() const { return m_shape.size(); }
+            const std::vector<size_t>& shape() const { return m_shape; }
+
+            /// Number of stored values.
+            size_t nnz() const { return m_nnz; }
+
+            /// Number of elements, including zeros.
+            size_t size() const
+            {
+                size_t n = 1;
+                for (auto s : m_shape) { n *= s; }
+                return n;
+            }
+
+            const ElementType* values() const { return m_values; }
+
+            /// The nnz indices of the dimension.  For "csr" these
+            /// are the column indices regardless of dim.
+            const IndexType* indices(size_t dim = 0) const
+            {
+                return m_csr ? m_indices : m_indices + dim * m_nnz;
+            }
+
+            /// The row offsets of "csr", else nullptr.
+            const IndexType* indptr() const { return m_indptr; }
+
+            /*! Call func(offsets, values, n) for consecutive blocks
+             * of at most block_size stored elements.  The offsets
+             * are C order, in elements, as size_t.
+             *
+             * Throw std::out_of_range on an index outside the shape.
+             */
+            template <typename Func>
+            void for_each_block(Func func) const
+            {
+                size_t offsets[block_size];
+                size_t row = 0;
+                for (size_t beg = 0; beg < m_nnz; beg += block_size) {
+                    const size_t num = std::min(block_size, m_nnz - beg);
+                    if (m_csr) {
+                        row = csr_offsets(beg, num, row, offsets);
+                    }
+                    else {
+                        coo_offsets(beg, num, offsets);
+                    }
+                    func((const size_t*)offsets, m_values + beg, num);
+                }
+            }
+
+            /// Write all elements, including zeros, to out which
+            /// must hold size() elements.
+            void densify(ElementType* out) const
+            {
+                std::fill(out, out + size(), ElementType{});
+                for_each_block(
+                    [out](const size_t* off, const ElementType* val, size_t n) {
+                        for (size_t ind = 0; ind < n; ++ind) {
+                            out[off[ind]] = val[ind];
+                        }
+                    });
+            }
+
+            /// Return all elements, including zeros.
+            std::vector<ElementType> densify() const
+            {
+                std::vector<ElementType> ret(size());
+                densify(ret.data());
+                return ret;
+            }
+
+          private:
+            // One pass per dimension over contiguous coordinates.
+            void coo_offsets(size_t beg, size_t num, size_t* off) const
+            {
+                std::fill(off, off + num, 0);
+                for (size_t dim = 0; dim < m_shape.size(); ++dim) {
+                    const IndexType* idx = m_indices + dim * m_nnz + beg;
+                    const size_t stride = m_strides[dim];
+                    IndexType biggest = 0;
+                    for (size_t ind = 0; ind < num; ++ind) {
+                        biggest = std::max(biggest, idx[ind]);
+                        off[ind] += idx[ind] * stride;
+                    }
+                    if ((size_t)biggest >= m_shape[dim]) {
+                        throw std::out_of_range("sparse view: bad index");
+                    }
+                }
+            }
+
+            // Return the row holding the element after the block.
+            size_t csr_offsets(size_t beg, size_t num, size_t row,
+                               size_t* off) const
+            {
+                const size_t nrows = m_shape[0], ncols = m_shape[1];
+                for (size_t ind = 0; ind < num; ++ind) {
+                    while (row < nrows and m_indptr[row + 1] <= beg + ind) {
+                        ++row;
+                    }
+                    const size_t col = m_indices[beg + ind];
+                    if (row >= nrows or col >= ncols) {
+                        throw std::out_of_range("sparse view: bad index");
+                    }
+                    off[ind] = row * ncols + col;
+                }
+                return row;
+            }
+
+            const ElementType* m_values{nullptr};
+            const IndexType* m_indices{nullptr};
+            const IndexType* m_indptr{nullptr};
+            size_t m_nnz{0};
+            bool m_csr{false};
+            std::vector<size_t> m_shape{};
+            std::vector<size_t> m_strides{};
+        };
+
+        /*! Index all tensors of a message with a single label parse.
+         *
+         * Tensors described in the label JSON or in a binary
+         * descriptor part (see @ref Builder) are both handled.
+         *
+         * The message must outlive the reader and not be modified.
+         */
+        class Reader
+        {
+          public:
+            explicit Reader(const Message& msg);
+
+            /// Number of tensors described by the label.
+            size_t size() const { return m_refs.size(); }
+
+            /// Throw std::out_of_range if index is too large.
+            const TensorRef& ref(size_t index) const
+            {
+                return m_refs.at(index);
+            }
+
+            /// Return an invalid view if the index is out of range,
+            /// the tensor is unresolved, sparse or its element type
+            /// is not ElementType.
+            template <typename ElementType>
+            View<ElementType> view(size_t index) const
+            {
+                if (index >= m_refs.size()) { return View<ElementType>(); }
+                const auto& ref = m_refs[index];
+                if (!ref or ref.sparse() or !matches<ElementType>(ref)) {
+                    return View<ElementType>();
+                }
+                return View<ElementType>((const ElementType*)ref.data,
+                                         ref.shape, ref.strides);
+            }
+
+            /// The stored elements of a quantized tensor, eg as
+            /// uint16_t for "f16" and "bf16" or int16_t for "i16".
+            /// Invalid if the tensor is not quantized or StoredType
+            /// is of another size.
+            template <typename StoredType>
+            View<StoredType> quantized(size_t index) const
+            {
+                if (index >= m_refs.size()) { return View<StoredType>(); }
+                const auto& ref = m_refs[index];
+                if (!ref or !ref.quantized() or
+                    ref.word != sizeof(StoredType)) {
+                    return View<StoredType>();
+                }
+                return View<StoredType>((const StoredType*)ref.data,
+                                        ref.shape, ref.strides);
+            }
+
+            /// The decoded elements of a quantized tensor, with the
+            /// ref() shape and strides.  Empty if not quantized.
+            std::vector<float> dequantize(size_t index) const;
+
+            /// As view() but for sparse tensors, which must also
+            /// have indices of IndexType.
+            template <typename ElementType, typename IndexType = uint32_t>
+            SparseView<ElementType, IndexType> sparse(size_t index) const
+            {
+                typedef SparseView<ElementType, IndexType> view_type;
+                if (index >= m_refs.size()) { return view_type(); }
+                const auto& ref = m_refs[index];
+                if (!ref or !ref.sparse() or !matches<ElementType>(ref) or
+                    ref.index_word != sizeof(IndexType)) {
+                    return view_type();
+                }
+                return view_type(ref);
+            }
+
+          private:
+            template <typename ElementType>
+            static bool matches(const TensorRef& ref)
+            {
+                return dtype_matches<ElementType>(ref.dtype, ref.word);
+            }
+
+            std::vector<TensorRef> m_refs;
+        };
+
+        /*! Append many tensors with a compact binary description.
+         *
+         * Instead of one JSON object per tensor in the label, the
+         * tensors are described in a binary descriptor part which is
+         * added by finish() along with a label entry giving its part
+         * index.  Appending is O(1) per tensor and a @ref Reader
+         * indexes the result without JSON.  Per-tensor metadata is
+         * not supported.  The JSON append() must not also be used on
+         * the same message.
+         *
+         * A packed builder instead copies every tensor into one
+         * frame, each starting at a multiple of the alignment from
+         * the start of the frame which is itself aligned.  The
+         * descriptor records each offset.  Sending is then of two
+         * parts regardless of the number of tensors and receiving
+         * needs a single allocation.  Its tensors are found with
+         * at<T>() or a @ref Reader, not the untyped at().
+         */
+        class Builder
+        {
+          public:
+            /// Throw std::runtime_error if msg already holds JSON
+            /// described tensors.
+            explicit Builder(Message& msg);
+
+            /// A packed builder with an initial reserve of bytes for
+            /// the frame, which grows as needed.  No other parts may
+            /// be added to msg before finish().
+            Builder(Message& msg, size_t reserve,
+                    size_t alignment = default_alignment);
+            ~Builder();
+
+            Builder(const Builder&) = delete;
+            Builder& operator=(const Builder&) = delete;
+
+            /// Append data which is moved into the message, or copied
+            /// into the frame if packed.
+            void append(message_t&& data, const std::vector<size_t>& shape,
+                        size_t word, const std::string& dtype);
+
+            /// Append a copy of nbytes of data.
+            void append_copy(const void* data, size_t nbytes,
+                             const std::vector<size_t>& shape, size_t word,
+                             const std::string& dtype);
+
+            /// Append a copy of the array.
+            template <typename ElementType>
+            void append(const ElementType* data,
+                        const std::vector<size_t>& shape)
+            {
+                size_t nbytes = sizeof(ElementType);
+                for (auto s : shape) { nbytes *= s; }
+                append_copy(data, nbytes, shape, sizeof(ElementType),
+                            dtype<ElementType>());
+            }
+
+            /// Number of tensors appended so far.
+            size_t size() const { return m_count; }
+
+            /// True if tensors are packed into one frame.
+            bool packed() const { return m_alignment != 0; }
+
+            /// Add the descriptor part, and if packed the frame, to
+            /// the message.  No more tensors may be appended.
+            void finish();
+
+          private:
+            void add(message_t&& data, const std::vector<size_t>& shape,
+                     size_t word, const std::string& dtype, bool has_crc,
+                     uint32_t crc);
+            void pack(const void* data, size_t nbytes,
+                      const std::vector<size_t>& shape, size_t word,
+                      const std::string& dtype);
+            void reserve(size_t nbytes);
+
+            Message& m_msg;
+            bool m_checksums;  // as set on the message at construction
+            std::string m_desc;
+            size_t m_count{0};
+            bool m_finished{false};
+
+            // Packed only
+            char* m_pack{nullptr};
+            size_t m_used{0}, m_reserved{0}, m_alignment{0}, m_part{0};
+        };
+
+        /*! Put chunked tensors back together.
+         *
+         * Chunks (see append_chunk()) are added as messages arrive,
+         * in any order, and copied into place in a buffer holding
+         * the whole tensor.  The leading rows which have all arrived
+         * are available before the rest so processing may proceed
+         * while later chunks are still in flight.
+         */
+        class Reassembler
+        {
+          public:
+            /// Default bound on the size of one whole tensor.
+            static constexpr size_t default_max_bytes = 1ULL << 32;
+
+            /// A whole tensor may be at most max_bytes.
+            explicit Reassembler(size_t max_bytes = default_max_bytes)
+                : m_max_bytes(max_bytes)
+            {
+            }
+
+            /// Copy in all chunks of the message, returning their
+            /// number.  Throw std::runtime_error if a chunk does not
+            /// match earlier chunks of its tensor or its checksum or
+            /// if the whole tensor would exceed max_bytes.
+            size_t add(const Message& msg);
+
+            /// Ids of the tensors with at least one chunk.
+            std::vector<std::string> ids() const;
+
+            /// True if any chunk of the tensor has been added.
+            bool has(const std::string& id) const;
+
+            /// Number of leading rows of the tensor which have all
+            /// arrived.  Zero if the id is unknown.
+            size_t ready(const std::string& id) const;
+
+            /// True if every row of the tensor has arrived.
+            bool complete(const std::string& id) const;
+
+            /// Describe the whole tensor, with the data so far.
+            /// Throw std::out_of_range if the id is unknown.
+            TensorRef ref(const std::string& id) const;
+
+            /// A view of the ready rows, invalid if the id is
+            /// unknown or of another element type.
+            template <typename ElementType>
+            View<ElementType> view(const std::string& id) const
+            {
+                auto it = m_tensors.find(id);
+                if (it == m_tensors.end()) { return View<ElementType>(); }
+                const auto& one = it->second;
+                if (!dtype_matches<ElementType>(one.dtype, one.word)) {
+                    return View<ElementType>();
+                }
+                auto shape = one.shape;
+                shape[0] = ready(id);
+                return View<ElementType>(one.data.data<ElementType>(), shape,
+                                         c_strides(one.shape));
+            }
+
+            /// Remove the tensor, returning its data.  This is the
+            /// whole tensor only if it is complete.
+            message_t take(const std::string& id);
+
+          private:
+            struct Whole
+            {
+                message_t data;
+                std::string dtype;
+                size_t word{0};
+                std::vector<size_t> shape;
+                size_t row_bytes{0};
+                std::map<size_t, size_t> rows;  // [begin, end) arrived
+            };
+            std::map<std::string, Whole> m_tensors;
+            size_t m_max_bytes;
+        };
+
+        /// True if data is aligned to alignment bytes.
+        inline bool is_aligned(const void* data, size_t alignment)
+        {
+            return ((uintptr_t)data & (alignment - 1)) == 0;
+        }
+
+        /*! Make all tensor data of the message aligned.
+         *
+         * Received parts may land at any offset in a transport
+         * buffer.  Each part holding tensor data, or sparse indices,
+         * which is not aligned to alignment bytes (a power of two)
+         * is replaced by an aligned copy.  Return the number of
+         * parts copied.  Copies are also counted by align_stats().
+         */
+        size_t align(Message& msg, size_t alignment = default_alignment);
+
+        /// Process wide count of the copies made by align().
+        struct AlignStats
+        {
+            size_t copies{0};
+            size_t bytes{0};
+        };
+        AlignStats align_stats();
+        void reset_align_stats();
+
     }  // namespace tens
 }  // namespace zio
 
@@ -4,6 +4,7 @@
 #include "zio/cppzmq.hpp"
 #include "zio/json.hpp"
 
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -50,6 +51,39 @@ namespace zio {
     uint32_t to_rid(const remote_identity_t& remid);
     std::string binstr(const std::string& s);
 
+    // Return a part which references, without copying, size bytes
+    // of externally owned data.  The owner is held until libzmq is
+    // done with the part, possibly after the send call returns.  The
+    // data must not be modified until then.  For a C-style release,
+    // construct a message_t with a zmq::free_fn directly.
+    message_t shared_message(const void* data, size_t size,
+                             std::shared_ptr<const void> owner);
+
+    // Return an uninitialized part of size bytes whose data is
+    // aligned to alignment bytes, which must be a power of two.
+    message_t aligned_message(size_t size, size_t alignment);
+
+    // As above but holding a copy of data.
+    message_t aligned_message(const void* data, size_t size,
+                              size_t alignment);
+
+    // Return the CRC-32C (Castagnoli) of data, continuing from the
+    // crc of preceding data.  SSE4.2 instructions are used if the
+    // CPU has them.
+    uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+    // Copy size bytes from src to dst and return the CRC-32C of
+    // them.  The CRC is computed block by block while each block is
+    // still in cache.
+    uint32_t crc32c_copy(void* dst, const void* src, size_t size,
+                         uint32_t crc = 0);
+
+    // Decode a single-part encoded message, appending its parts to
+    // mmsg.  Parts larger than a small threshold are not copied but
+    // reference the memory of the encoded message which is kept
+    // alive until the last such part is destroyed.
+    void decode_adopt(message_t&& encoded, multipart_t& mmsg);
+
     // Return true if socket is like a server
     bool is_serverish(zio::socket_t& sock);
     // Return true if socket is like a client
@@ -19,6 +19,9 @@ setuptools.setup(
         "jsonnet",
         "transitions",
     ],
+    extras_require = dict(
+        labels = ["cbor2", "msgpack"], # for binary encoded labels
+    ),
     entry_points = dict(
         console_scripts = [
             'zio = zio.__main__:main',
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+'''
+Benchmark of the Python flow broker.
+
+This is the counterpart of test/check_broker.cpp: client actors give
+DAT through a zio.flow.Broker to handler actors started by its
+factory.
+
+  check_flowbroker.py [clients] [messages per client] [credit]
+'''
+
+import sys
+import time
+import zmq
+import zio
+from zio.flow import Broker, Flow, TransmissionEnd
+from pyre.zactor import ZActor
+
+address = "tcp://127.0.0.1:5563"
+
+
+def giver(ctx, pipe, ndats, credit):
+    pipe.signal()
+    port = zio.Port("client", zmq.CLIENT, '')
+    port.connect(address)
+    port.online(None)
+    flow = Flow(port, 'extract', credit)
+    assert(flow.bot())
+    flow.begin()
+    for ind in range(ndats):
+        flow.put(zio.Message(form='FLOW', label_object={'flow':'DAT'}))
+    flow.eot()
+    port.offline()
+    pipe.recv()
+
+
+def taker(ctx, pipe, bot):
+    pipe.signal()
+    port = zio.Port("handler", zmq.CLIENT, '')
+    port.connect(address)
+    port.online(None)
+    fobj = bot.label_object
+    flow = Flow(port, fobj["direction"], fobj["credit"])
+    assert(flow.bot(bot))
+    flow.begin()
+    while True:
+        try:
+            flow.get()
+        except TransmissionEnd:
+            flow.eotsend()
+            break
+    port.offline()
+    pipe.recv()
+
+
+class Factory:
+    def __init__(self):
+        self.ctx = zmq.Context()
+        self.handlers = list()
+
+    def __call__(self, bot):
+        self.handlers.append(ZActor(self.ctx, taker, bot))
+        return True
+
+    def stop(self):
+        for actor in self.handlers:
+            actor.pipe.signal()
+
+
+def main(nclients=4, ndats=1000, credit=10):
+    node = zio.Node("check-flowbroker")
+    server = node.port("server", zmq.SERVER)
+    server.bind(address)
+    node.online()
+
+    ctx = zmq.Context()
+    factory = Factory()
+    broker = Broker(server, factory)
+
+    start = time.time()
+    clients = [ZActor(ctx, giver, ndats, credit) for ind in range(nclients)]
+
+    nrouted = 0
+    while True:
+        try:
+            broker.poll(1000)
+        except TimeoutError:
+            break
+        nrouted += 1
+    elapsed = time.time() - start - 1.0  # less the final timeout
+
+    print(f'{nclients} clients of {ndats} DAT with {credit} credit')
+    print(f'routed {nrouted} messages, {1e-3*nrouted/elapsed:.3f} kHz, '
+          f'DAT {1e-3*nclients*ndats/elapsed:.3f} kHz')
+
+    broker.stop()
+    node.offline()
+    for client in clients:
+        client.pipe.signal()
+
+
+if '__main__' == __name__:
+    main(*map(int, sys.argv[1:]))
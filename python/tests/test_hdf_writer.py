@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+'''
+test zio.flow.hdf.writer
+'''
+
+import json
+import unittest
+
+import h5py
+import numpy
+
+from zio import Message
+from zio.flow.hdf.writer import TensWriter, tensor_array
+
+
+class TestTensWriter(unittest.TestCase):
+
+    def setUp(self):
+        self.arr = numpy.arange(24, dtype='<f4').reshape(2, 3, 4)
+
+    def test_c_order(self):
+        md = dict(shape=[2, 3, 4], word=4, dtype='<f4')
+        got = tensor_array(self.arr.tobytes(order='C'), md)
+        self.assertTrue(numpy.array_equal(got, self.arr))
+
+    def test_fortran_order(self):
+        md = dict(shape=[2, 3, 4], word=4, dtype='<f4', order=[0, 1, 2])
+        got = tensor_array(self.arr.tobytes(order='F'), md)
+        self.assertTrue(numpy.array_equal(got, self.arr))
+
+    def test_permuted_order(self):
+        # dimension 1 varies fastest, then 0, then 2
+        data = self.arr.transpose(2, 0, 1).tobytes(order='C')
+        md = dict(shape=[2, 3, 4], word=4, dtype='<f4', order=[1, 0, 2])
+        got = tensor_array(data, md)
+        self.assertTrue(numpy.array_equal(got, self.arr))
+
+    def test_rejects(self):
+        md = dict(shape=[2, 3, 4], word=4, dtype='<f4', strides=[12, 4, 1])
+        with self.assertRaises(ValueError):
+            tensor_array(self.arr.tobytes(), md)
+        md = dict(shape=[2, 3, 4], word=4, dtype='<f4', order=[0, 0, 2])
+        with self.assertRaises(ValueError):
+            tensor_array(self.arr.tobytes(), md)
+
+    def test_save(self):
+        lobj = dict(TENS=dict(tensors=[
+            dict(shape=[2, 3, 4], word=4, dtype='<f4', order=[0, 1, 2])]))
+        msg = Message(form='TENS', label=json.dumps(lobj), seqno=1,
+                      payload=[self.arr.tobytes(order='F')])
+        with h5py.File('test_hdf_writer.hdf', 'w', driver='core',
+                       backing_store=False) as fp:
+            TensWriter(fp.create_group("test")).save(msg)
+            got = fp["test/0001/tensors/00"][()]
+        self.assertTrue(numpy.array_equal(got, self.arr))
+
+
+if __name__ == '__main__':
+    unittest.main()
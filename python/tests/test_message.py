@@ -41,6 +41,50 @@ class TestMessage(unittest.TestCase):
     def test_ctor_headers(self):
         msg = zio.Message(coord = zio.CoordHeader(seqno=100))
         assert(msg.seqno == 100)
+
+    def test_label_encoding(self):
+        lobj = dict(flow='DAT', credit=3)
+        for enc in ('json', 'cbor', 'msgpack'):
+            msg = zio.Message(form='FLOW')
+            msg.label_encoding = enc
+            msg.label_object = lobj
+            msg2 = zio.Message(parts=msg.toparts())
+            assert (msg2.label_encoding == enc)
+            assert (msg2.label_object == lobj)
+
+    def test_flow_fields(self):
+        # as sent by C++, flow fields follow the coord header
+        ch = zio.CoordHeader(seqno=3, flow=dict(flow='PAY', credit=4))
+        part = bytes(ch)
+        assert (len(part) == 32)
+        msg = zio.Message(parts=[bytes(zio.PrefixHeader(form='FLOW',
+                                                        label='{"app": 1}')),
+                                 part])
+        assert (msg.seqno == 3)
+        assert (msg.label_object == dict(app=1, flow='PAY', credit=4))
+        # setting the flow attributes in the label takes them from there
+        fobj = msg.label_object
+        fobj['credit'] = 2
+        msg.label_object = fobj
+        assert (msg.coord.flow is None)
+        assert (len(msg.toparts()[1]) == 24)
+        assert (msg.label_object['credit'] == 2)
+
+    def test_flow_fields_unknown_type(self):
+        # C++ keeps direction and credit when the type is cleared
+        ch = zio.CoordHeader(flow=dict(direction='inject', credit=4))
+        part = bytes(ch)
+        assert (len(part) == 32)
+        got = zio.CoordHeader(part)
+        assert (got.flow == dict(direction='inject', credit=4))
+
+    def test_flow_fields_odd_label(self):
+        flow = dict(flow='DAT', credit=1)
+        for label, lobj in (('', flow), ('null', flow), ('5', 5)):
+            msg = zio.Message(form='FLOW', label=label,
+                              coord=zio.CoordHeader(flow=dict(flow)))
+            assert (msg.label_object == lobj)
+            assert (msg.coord.flow == flow)
         
 
 if __name__ == '__main__':
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+'''
+Decompress message payload compressed by a C++ zio::Port.
+
+The codec name and original part sizes are recorded in the label
+object under the reserved "zio.codec" key.  The "zlib" codec uses the standard
+library, "lz4" requires the lz4 module and "zstd" the zstandard
+module.
+'''
+
+key = "zio.codec"
+
+def _zlib(data, size):
+    import zlib
+    return zlib.decompressobj().decompress(data, size)
+
+def _lz4(data, size):
+    import lz4.block
+    return lz4.block.decompress(data, uncompressed_size=size)
+
+def _zstd(data, size):
+    import zstandard
+    return zstandard.ZstdDecompressor().decompress(data, max_output_size=size)
+
+decompressors = dict(zlib=_zlib, lz4=_lz4, zstd=_zstd)
+
+def decompress(msg):
+    '''
+    Decompress the message payload in place, restoring its label.
+    Return True if the message was compressed.
+    '''
+    label = msg.label
+    if not label:
+        return False
+    if (key.encode() if isinstance(label, bytes) else key) not in label:
+        return False
+    lobj = msg.label_object
+    if not isinstance(lobj, dict) or key not in lobj:
+        return False
+    rec = lobj.pop(key)
+    if not isinstance(rec, dict):
+        raise ValueError('malformed codec record')
+    name = rec.get("name")
+    if name not in decompressors:
+        raise ValueError(f'unknown codec: "{name}"')
+    sizes = rec.get("sizes")
+    if not isinstance(sizes, list) or len(sizes) != len(msg.payload) or \
+       not all(isinstance(n, int) and n >= 0 for n in sizes):
+        raise ValueError('malformed codec record')
+    blank = rec.get("empty")
+    if not isinstance(blank, bool):
+        raise ValueError('malformed codec record')
+    fn = decompressors[name]
+    msg.payload = [fn(bytes(p), n) if n else p
+                   for p, n in zip(msg.payload, sizes)]
+    if blank:
+        msg.label = ""
+    else:
+        msg.label_object = lobj
+    return True
@@ -76,8 +76,8 @@ class TensReader:
             log.debug(f'TENS part {part}/{nparts} {dtype} {type(ds.dtype)} {ds.shape}')
             md.update(dict(
                 shape = ds.shape,
-                dtype = ds.dtype.kind,
-                word = ds.dtype.alignment,
+                dtype = ds.dtype.str,
+                word = ds.dtype.itemsize,
                 part = part))
             tensors.append(md)
             payload[part] = ds[:].tostring()
@@ -24,6 +24,39 @@ from zio.util import message_to_dict, modlog, objectify
 log = modlog(__name__)
 
 
+def tensor_array(data, tenmd):
+    '''Return a numpy array of the dense tensor data as described.
+
+    The array has the described shape whatever its storage "order"
+    so that, eg, a Fortran order tensor is not written transposed.
+    A ValueError is raised for a description giving "strides" or an
+    invalid "order".
+    '''
+    sword = str(tenmd['word'])
+    shape = list(tenmd['shape'])
+    dtype = str(tenmd['dtype'])
+    # Older senders give only the kind character.
+    if len(dtype) == 1:
+        dtype += sword
+    if 'strides' in tenmd:
+        raise ValueError('strided tensors are not supported')
+    arr = numpy.frombuffer(data, dtype=dtype)
+
+    rank = len(shape)
+    order = list(tenmd.get('order', range(rank-1, -1, -1)))
+    if sorted(order) != list(range(rank)):
+        raise ValueError(f'invalid tensor order {order}')
+    if order == list(range(rank-1, -1, -1)):
+        return arr.reshape(shape)
+    if order == list(range(rank)):
+        return arr.reshape(shape, order='F')
+    # The first order entry varies fastest so, in reverse, it gives
+    # the dimensions of a C order array to be transposed back.
+    slowest = order[::-1]
+    arr = arr.reshape([shape[dim] for dim in slowest])
+    return arr.transpose([slowest.index(dim) for dim in range(rank)])
+
+
 class TensWriter:
     '''Write ZIO TENS messages to HDF5.
 
@@ -84,16 +117,15 @@ class TensWriter:
             part = int(tenmd.get('part', tenind))
             ten = parts[part]
             
-            # required
-            sword = str(tenmd['word'])
-            shape = list(tenmd['shape'])
-            dtype = str(tenmd['dtype'])
+            log.debug(f'TENS PART: {tenind}/{nparts} {tenmd}')
 
-            log.debug(f'TENS PART: {tenind}/{nparts} {dtype} {sword} {shape}')
-
-            data = numpy.frombuffer(ten, dtype=dtype+sword).reshape(shape)
+            try:
+                data = tensor_array(ten, tenmd)
+            except ValueError as err:
+                log.error(f'writer: skip tensor {tenind}: {err}')
+                continue
             ds = tens.create_dataset(self.part_interp % part,
-                                     data = data,
+                                     data = numpy.ascontiguousarray(data),
                                      chunks = True)
 
         if user_md:
@@ -154,8 +154,10 @@ class Flow(object):
         if got_cred < 0:
             log.debug(f'negative pay {msg}')
             return False
-        if got_cred + self.credit > self.total_credit:
-            log.debug(f'too much pay: {got_cred}+{self.credit}>{self.total_credit} {msg}')
+        # an adaptive taker may resize the credit window
+        total = fobj.get('window', 0) or self.total_credit
+        if got_cred + self.credit > total:
+            log.debug(f'too much pay: {got_cred}+{self.credit}>{total} {msg}')
             return False
         return True
 
@@ -239,6 +241,7 @@ class Flow(object):
         self.recv_seqno += 1
         fobj = msg.label_object
         self.credit += fobj["credit"]
+        self.total_credit = fobj.get('window', 0) or self.total_credit
 
     def flush_pay(self, msg):
         msg.form='FLOW'
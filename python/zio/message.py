@@ -77,18 +77,22 @@ class PrefixHeader:
     def __bytes__(self):
         a = b'ZIO%d' % self.level.value
         b = bytes(self.form, 'utf-8')
-        c = bytes(self.label, 'utf-8')
+        c = self.label
+        if not isinstance(c, bytes):
+            c = bytes(c, 'utf-8')
         return a + b + c
 
 class CoordHeader:
     origin=0                    # where a message came from
     granule=0                   # when a message came from
     seqno=0                     # which message
+    flow=None                   # binary flow fields as a flow object
 
-    def __init__(self, *args, origin=0, granule=0, seqno=0):
+    def __init__(self, *args, origin=0, granule=0, seqno=0, flow=None):
         self.origin = origin
         self.granule = granule
         self.seqno = seqno
+        self.flow = flow
         if len(args) == 0:
             return
         if len(args) == 3:
@@ -96,10 +100,14 @@ class CoordHeader:
             return
         if type(args[0]) == bytes:
             self.origin,self.granule,self.seqno = decode_header_coord(args[0])
+            self.flow = decode_header_flow(args[0][24:])
             return
 
     def __bytes__(self):
-        return encode_header_coord(self.origin, self.granule, self.seqno)
+        ret = encode_header_coord(self.origin, self.granule, self.seqno)
+        if self.flow:
+            ret += encode_header_flow(self.flow)
+        return ret
 
     def __str__(self):
         return "[0x%x,%ld,%ld]" %(self.origin,self.granule,self.seqno)
@@ -121,6 +129,7 @@ class Message:
     prefix = None
     coord = None
     _payload = ()
+    label_encoding = "json"     # how label_object is set, see encode_label()
 
     def __init__(self,
                  level=None, form=None,
@@ -204,18 +213,33 @@ class Message:
     @label.setter
     def label(self, val):
         self.prefix.label = val
+        if self.coord.flow:
+            try:
+                lobj = decode_label(val)
+            except ValueError:
+                lobj = None
+            held = isinstance(lobj, dict) and 'flow' in lobj
+            if held:            # the label now says
+                self.coord.flow = None
 
     @property
     def label_object(self):
-        if not self.label:
-            return dict()
-        if type(self.label) is bytes:
-            return json.loads(self.decode('utf-8'))
-        return json.loads(self.label)
+        '''
+        The label object, including any binary flow fields.  A label
+        holding a JSON null is taken as empty.  Any other label which
+        is not an object is returned as-is and the flow fields are
+        left in coord.flow.
+        '''
+        lobj = decode_label(self.label)
+        if lobj is None:
+            lobj = dict()
+        if self.coord.flow and isinstance(lobj, dict):
+            lobj = dict(lobj, **self.coord.flow)
+        return lobj
 
     @label_object.setter
     def label_object(self, val):
-        self.label = json.dumps(val)
+        self.label = encode_label(val, self.label_encoding)
         
     @property
     def origin(self):
@@ -293,6 +317,7 @@ class Message:
         if len(parts) < 2:
             raise ValueError("must have at least two parts")
         self.prefix = PrefixHeader(parts[0])
+        self.label_encoding = label_encoding(self.prefix.label)
         self.coord = CoordHeader(parts[1])
         self.payload = parts[2:]
 
@@ -311,6 +336,54 @@ def encode_header_prefix(mform="FLOW", level=0, label=""):
     pre = pre.encode()
     return struct.pack('I', len(pre)) + pre
 
+# A label holding a binary encoded object starts with one of these
+# reserved bytes.  This matches C++ zio::label_encoding_e.
+label_markers = dict(cbor=1, msgpack=2)
+
+def label_encoding(label):
+    '''
+    Return the name of the encoding used by the label: "json", "cbor"
+    or "msgpack".
+    '''
+    if isinstance(label, bytes) and label:
+        for name, marker in label_markers.items():
+            if label[0] == marker:
+                return name
+    return "json"
+
+def encode_label(obj, encoding="json"):
+    '''
+    Return the label object encoded as a label.  A JSON label is
+    returned as a string, a binary one as bytes.  The binary
+    encodings require the cbor2 or msgpack modules.
+    '''
+    if encoding == "json":
+        return json.dumps(obj)
+    if encoding == "cbor":
+        import cbor2
+        return bytes([label_markers[encoding]]) + cbor2.dumps(obj)
+    if encoding == "msgpack":
+        import msgpack
+        return bytes([label_markers[encoding]]) + msgpack.packb(obj)
+    raise ValueError(f'unknown label encoding: "{encoding}"')
+
+def decode_label(label):
+    '''
+    Return the object held by the label in any encoding.
+    '''
+    if not label:
+        return dict()
+    encoding = label_encoding(label)
+    if encoding == "cbor":
+        import cbor2
+        return cbor2.loads(label[1:])
+    if encoding == "msgpack":
+        import msgpack
+        return msgpack.unpackb(label[1:])
+    if isinstance(label, bytes):
+        label = label.decode('utf-8')
+    return json.loads(label)
+
 def decode_header_prefix(henc):
     '''
     Parse the bytes of one encoded message part into a ZIO message
@@ -324,7 +397,9 @@ def decode_header_prefix(henc):
         return None
     level = henc[3]-ord('0')
     mform = henc[4:8].decode()
-    label = henc[8:].decode()
+    label = henc[8:]
+    if label_encoding(label) == "json":
+        label = label.decode()
     return (level, mform, label)
 
 def encode_header_coord(origin, granule, seqno):
@@ -340,9 +415,45 @@ def decode_header_coord(henc):
     Parse the bytes of one encoded message part into a ZIO message
     header coord.  This is ususally the second part of a multipart
     message or as returend by decode().  Returns tuple (origin,
-    granule, seqno) or None if parse error.
+    granule, seqno) or None if parse error.  Any flow fields
+    following the coord are ignored, see decode_header_flow().
+    '''
+    if len(henc) < 24:
+        return None
+    return struct.unpack('LLL', henc[:24]);
+
+# The binary flow fields which may follow the coord header in its part.
+# This matches C++ zio::FlowHeader and zio::flow::msgtype_e/direction_e.
+flow_msgtypes = (None, 'BOT', 'DAT', 'PAY', 'EOT')
+flow_directions = (None, 'inject', 'extract')
+
+def encode_header_flow(fobj):
     '''
-    if len(henc) != 24:
+    Return the binary flow fields of the flow object, a dict with
+    any of "flow", "direction", "window" and "credit" attributes.
+    '''
+    msgtype = flow_msgtypes.index(fobj.get('flow', None))
+    direction = flow_directions.index(fobj.get('direction', None))
+    return struct.pack('BBHi', msgtype, direction, fobj.get('window', 0),
+                       fobj.get('credit', -1))
+
+def decode_header_flow(henc):
+    '''
+    Return the flow object held in the binary flow fields or None if
+    there are none.  As in C++, the type may be unknown while other
+    fields are set, in which case "flow" is omitted.
+    '''
+    if len(henc) < 8:
         return None
-    return struct.unpack('LLL', henc);
+    msgtype, direction, window, credit = struct.unpack('BBHi', henc[:8])
+    fobj = dict()
+    if 0 < msgtype < len(flow_msgtypes):
+        fobj['flow'] = flow_msgtypes[msgtype]
+    if 0 < direction < len(flow_directions):
+        fobj['direction'] = flow_directions[direction]
+    if window > 0:
+        fobj['window'] = window
+    if credit >= 0:
+        fobj['credit'] = credit
+    return fobj or None
 
@@ -5,7 +5,10 @@ from zmq.error import ZMQError
 from zio.util import socket_names, modlog
 from zio.util import clientish_recv, clientish_send
 from zio.util import serverish_recv, serverish_send
+from zio.util import decode_message
+from collections import deque
 from zio.message import Message
+from zio.codec import decompress
 
 log = modlog(__name__)
 
@@ -53,6 +56,12 @@ def bind_hostport(sock, host, port):
     return "tcp://%s:%d" % (host, port)
             
 
+def is_batch(parts):
+    '''
+    Return True if parts hold a batch of encoded messages.
+    '''
+    return len(parts) > 2 and bytes(parts[0]) == b'ZIO*BTCH'
+
 class Port:
     def __init__(self, name, sock, hostname='127.0.0.1'):
         '''
@@ -77,6 +86,7 @@ class Port:
         self.bound = list()
         self.poller = zmq.Poller()
         self.poller.register(self.sock, zmq.POLLIN)
+        self.unbatched = deque()  # (rid, parts) from a received batch
 
     def __str__(self):
         return "[port %s]: type:%s binds:%d(todo:%d) conns:%d(todo:%d)" % \
@@ -245,24 +255,52 @@ class Port:
         return self.sock.send_multipart(msg.toparts())
 
 
+    def unbatch(self, rid, parts):
+        for enc in parts[2:]:
+            self.unbatched.append((rid, decode_message(enc)))
+        return self.recv_batched()
+
+    def recv_batched(self):
+        rid, parts = self.unbatched.popleft()
+        msg = Message(routing_id = rid, parts = parts)
+        log.debug(f'port [{self.name}] recv batched {msg}')
+        return msg
+
     def recv(self, timeout=None):
         '''
         Receive and return a zio.Message waiting up to a timeout 
 
         If timeout is reached then None is returned.
+
+        A batch of messages sent by a C++ port with batching is
+        unpacked and its messages returned by this and following
+        calls.  Compressed payload is decompressed.
         '''
+        msg = self.recv_one(timeout)
+        if msg is not None:
+            decompress(msg)
+        return msg
+
+    def recv_one(self, timeout):
+        if self.unbatched:
+            return self.recv_batched()
+
         which  = dict(self.poller.poll(timeout))
         if not self.sock in which:
             return None         # timeout
 
         if self.sock.type in (zmq.SERVER, zmq.ROUTER):
             rid, parts = serverish_recv(self.sock)
+            if is_batch(parts):
+                return self.unbatch(rid, parts)
             msg = Message(routing_id = rid, parts = parts)
             log.debug(f'port [{self.name}] recv {msg} rid:{msg.routing_id}')
             return msg
             
         if self.sock.type in (zmq.CLIENT, zmq.DEALER):
             parts = clientish_recv(self.sock)
+            if is_batch(parts):
+                return self.unbatch(0, parts)
             msg = Message(parts = parts)
             log.debug(f'port [{self.name}] recv {msg}')
             return msg
@@ -0,0 +1,394 @@
+#include "zio/codec.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef ZIO_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef ZIO_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef ZIO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace zio {
+    namespace codec {
+        const char* key = "zio.codec";
+    }
+}  // namespace zio
+
+namespace {
+
+    // Favor speed over ratio in all the builtins.
+
+#ifdef ZIO_HAVE_ZLIB
+    class ZlibCodec : public zio::codec::Codec
+    {
+      public:
+        std::string name() const { return "zlib"; }
+        size_t bound(size_t size) const { return compressBound(size); }
+        size_t expansion() const { return 1032; }
+        size_t compress(const void* data, size_t size, void* out) const
+        {
+            uLongf nout = bound(size);
+            int rc = compress2((Bytef*)out, &nout, (const Bytef*)data, size,
+                               Z_BEST_SPEED);
+            if (rc != Z_OK) { throw std::runtime_error("zlib compress failed"); }
+            return nout;
+        }
+        void decompress(const void* data, size_t size, void* out,
+                        size_t out_size) const
+        {
+            uLongf nout = out_size;
+            int rc = uncompress((Bytef*)out, &nout, (const Bytef*)data, size);
+            if (rc != Z_OK or nout != out_size) {
+                throw std::runtime_error("zlib decompress failed");
+            }
+        }
+    };
+#endif
+
+#ifdef ZIO_HAVE_LZ4
+    class Lz4Codec : public zio::codec::Codec
+    {
+      public:
+        std::string name() const { return "lz4"; }
+        size_t bound(size_t size) const
+        {
+            if (size > LZ4_MAX_INPUT_SIZE) {
+                throw std::runtime_error("lz4 input too large");
+            }
+            return LZ4_compressBound(size);
+        }
+        size_t expansion() const { return 255; }
+        size_t compress(const void* data, size_t size, void* out) const
+        {
+            int nout = LZ4_compress_default((const char*)data, (char*)out,
+                                            size, bound(size));
+            if (nout <= 0) { throw std::runtime_error("lz4 compress failed"); }
+            return nout;
+        }
+        void decompress(const void* data, size_t size, void* out,
+                        size_t out_size) const
+        {
+            int nout = LZ4_decompress_safe((const char*)data, (char*)out,
+                                           size, out_size);
+            if (nout < 0 or (size_t)nout != out_size) {
+                throw std::runtime_error("lz4 decompress failed");
+            }
+        }
+    };
+#endif
+
+#ifdef ZIO_HAVE_ZSTD
+    class ZstdCodec : public zio::codec::Codec
+    {
+      public:
+        std::string name() const { return "zstd"; }
+        size_t bound(size_t size) const { return ZSTD_compressBound(size); }
+        size_t expansion() const { return 32768; }
+        size_t compress(const void* data, size_t size, void* out) const
+        {
+            size_t nout = ZSTD_compress(out, bound(size), data, size, 1);
+            if (ZSTD_isError(nout)) {
+                throw std::runtime_error("zstd compress failed");
+            }
+            return nout;
+        }
+        void decompress(const void* data, size_t size, void* out,
+                        size_t out_size) const
+        {
+            size_t nout = ZSTD_decompress(out, out_size, data, size);
+            if (ZSTD_isError(nout) or nout != out_size) {
+                throw std::runtime_error("zstd decompress failed");
+            }
+        }
+    };
+#endif
+
+    typedef std::map<std::string, zio::codec::codecptr_t> registry_t;
+
+    // Guards the registry which ports on any thread may consult.
+    std::mutex registry_mutex;
+
+    registry_t& registry()
+    {
+        static registry_t reg = []() {
+            registry_t builtin;
+#ifdef ZIO_HAVE_ZLIB
+            builtin["zlib"] = std::make_shared<ZlibCodec>();
+#endif
+#ifdef ZIO_HAVE_LZ4
+            builtin["lz4"] = std::make_shared<Lz4Codec>();
+#endif
+#ifdef ZIO_HAVE_ZSTD
+            builtin["zstd"] = std::make_shared<ZstdCodec>();
+#endif
+            return builtin;
+        }();
+        return reg;
+    }
+
+    // Replace the label in the prefix header part, with an empty
+    // label if blank.
+    void replace_label(zio::message_t& part, const zio::json& lobj,
+                       zio::label_encoding_e enc, bool blank = false)
+    {
+        zio::PrefixHeaderView view;
+        view.loads(part);
+        zio::PrefixHeader ph;
+        ph.loads(view);
+        ph.label = blank ? "" : zio::dump_label(lobj, enc);
+        ph.dump(part);
+    }
+
+    // Threads kept for the life of the process to compress parts
+    // of large messages.  It grows to the largest number asked for.
+    class WorkPool
+    {
+      public:
+        ~WorkPool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_done = true;
+            }
+            m_cv.notify_all();
+            for (auto& one : m_threads) { one.join(); }
+        }
+
+        std::future<void> submit(std::function<void()> fn, size_t nthreads)
+        {
+            std::packaged_task<void()> task(std::move(fn));
+            auto fut = task.get_future();
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                while (m_threads.size() < nthreads) {
+                    m_threads.emplace_back([this]() { run(); });
+                }
+                m_tasks.push_back(std::move(task));
+            }
+            m_cv.notify_one();
+            return fut;
+        }
+
+      private:
+        void run()
+        {
+            while (true) {
+                std::packaged_task<void()> task;
+                {
+                    std::unique_lock<std::mutex> lk(m_mutex);
+                    m_cv.wait(lk, [this]() { return m_done or !m_tasks.empty(); });
+                    if (m_tasks.empty()) { return; }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<std::packaged_task<void()>> m_tasks;
+        std::vector<std::thread> m_threads;
+        bool m_done{false};
+    };
+
+    WorkPool& work_pool()
+    {
+        static WorkPool pool;
+        return pool;
+    }
+
+}  // anonymous namespace
+
+void zio::codec::add(codecptr_t codec)
+{
+    std::lock_guard<std::mutex> lk(registry_mutex);
+    registry()[codec->name()] = codec;
+}
+
+zio::codec::codecptr_t zio::codec::get(const std::string& name)
+{
+    std::lock_guard<std::mutex> lk(registry_mutex);
+    auto& reg = registry();
+    auto it = reg.find(name);
+    if (it == reg.end()) { return nullptr; }
+    return it->second;
+}
+
+std::vector<std::string> zio::codec::names()
+{
+    std::lock_guard<std::mutex> lk(registry_mutex);
+    std::vector<std::string> ret;
+    for (const auto& one : registry()) { ret.push_back(one.first); }
+    return ret;
+}
+
+bool zio::codec::compress(zio::multipart_t& mmsg, const Codec& codec,
+                          size_t threshold, size_t nthreads)
+{
+    if (mmsg.size() < 3) { return false; }
+    PrefixHeaderView view;
+    if (!view.loads(mmsg[0])) {
+        throw std::runtime_error("codec: failed to parse prefix");
+    }
+    const auto enc = label_encoding(view.label);
+    zio::json lobj = zio::json::value_t::object;
+    if (!view.label.empty()) {
+        lobj = load_label(view.label);
+        if (!lobj.is_object() or lobj.contains(key)) { return false; }
+    }
+
+    const size_t npay = mmsg.size() - 2;
+    std::vector<size_t> todo;
+    for (size_t ind = 0; ind < npay; ++ind) {
+        const size_t siz = mmsg[ind + 2].size();
+        if (siz and siz >= threshold) { todo.push_back(ind); }
+    }
+    if (todo.empty()) { return false; }
+
+    // Parts are independent so each worker takes every nth one.  A
+    // part which does not shrink leaves its output empty.
+    nthreads = std::max((size_t)1, std::min(nthreads, todo.size()));
+    std::vector<message_t> out(todo.size());
+    auto work = [&](size_t first) {
+        std::vector<char> scratch;
+        for (size_t ind = first; ind < todo.size(); ind += nthreads) {
+            const auto& part = mmsg[todo[ind] + 2];
+            scratch.resize(codec.bound(part.size()));
+            size_t nout = codec.compress(part.data(), part.size(),
+                                         scratch.data());
+            if (nout < part.size()) {
+                out[ind] = message_t(scratch.data(), nout);
+            }
+        }
+    };
+    std::vector<std::future<void>> workers;
+    for (size_t ind = 1; ind < nthreads; ++ind) {
+        workers.push_back(work_pool().submit(
+            [&work, ind]() { work(ind); }, nthreads - 1));
+    }
+    // Workers use this frame so all must finish before any error
+    // unwinds it.
+    std::exception_ptr err;
+    try {
+        work(0);
+    }
+    catch (...) {
+        err = std::current_exception();
+    }
+    for (auto& one : workers) {
+        try {
+            one.get();
+        }
+        catch (...) {
+            if (!err) { err = std::current_exception(); }
+        }
+    }
+    if (err) { std::rethrow_exception(err); }
+
+    std::vector<size_t> sizes(npay, 0);
+    bool any = false;
+    for (size_t ind = 0; ind < todo.size(); ++ind) {
+        if (out[ind].empty()) { continue; }
+        auto& part = mmsg[todo[ind] + 2];
+        sizes[todo[ind]] = part.size();
+        part = std::move(out[ind]);
+        any = true;
+    }
+    if (!any) { return false; }
+
+    lobj[key] = {{"name", codec.name()},
+                 {"sizes", sizes},
+                 {"empty", view.label.empty()}};
+    replace_label(mmsg[0], lobj, enc);
+    return true;
+}
+
+bool zio::codec::compress(zio::Message& msg, const Codec& codec,
+                          size_t threshold, size_t nthreads)
+{
+    const auto remid = msg.remote_id();
+    auto mmsg = std::move(msg).toparts();
+    bool ok = compress(mmsg, codec, threshold, nthreads);
+    msg.fromparts(std::move(mmsg));
+    msg.set_remote_id(remid);
+    return ok;
+}
+
+bool zio::codec::decompress(zio::multipart_t& mmsg)
+{
+    if (mmsg.size() < 3) { return false; }
+    PrefixHeaderView view;
+    if (!view.loads(mmsg[0])) { return false; }
+    // Avoid parsing labels which can not hold a record.
+    if (view.label.find(key) == std::string_view::npos) { return false; }
+    const auto enc = label_encoding(view.label);
+    zio::json lobj = load_label(view.label);
+    if (!lobj.is_object()) { return false; }
+    auto rec = lobj.find(key);
+    if (rec == lobj.end() or !rec->is_object()) { return false; }
+
+    const auto jname = rec->find("name");
+    if (jname == rec->end() or !jname->is_string()) {
+        throw std::runtime_error("codec: malformed record");
+    }
+    const std::string name = jname->get<std::string>();
+    auto codec = get(name);
+    if (!codec) { throw std::runtime_error("codec: unknown codec " + name); }
+    const size_t npay = mmsg.size() - 2;
+    const auto sizes = rec->find("sizes");
+    if (sizes == rec->end() or !sizes->is_array() or sizes->size() != npay) {
+        throw std::runtime_error("codec: malformed record");
+    }
+    for (const auto& one : *sizes) {
+        if (!one.is_number_unsigned()) {
+            throw std::runtime_error("codec: malformed record");
+        }
+    }
+    const auto jempty = rec->find("empty");
+    if (jempty == rec->end() or !jempty->is_boolean()) {
+        throw std::runtime_error("codec: malformed record");
+    }
+    const bool blank = jempty->get<bool>();
+
+    for (size_t ind = 0; ind < npay; ++ind) {
+        const size_t raw = (*sizes)[ind].get<size_t>();
+        if (!raw) { continue; }
+        auto& part = mmsg[ind + 2];
+        // Do not let a peer make us allocate more than the codec
+        // could possibly have produced from this part.
+        if (raw / codec->expansion() > part.size()) {
+            throw std::runtime_error("codec: part size exceeds expansion");
+        }
+        message_t out(raw);
+        codec->decompress(part.data(), part.size(), out.data(), raw);
+        part = std::move(out);
+    }
+
+    lobj.erase(rec);
+    replace_label(mmsg[0], lobj, enc, blank);
+    return true;
+}
+
+bool zio::codec::decompress(zio::Message& msg)
+{
+    if (msg.prefix().label.find(key) == std::string::npos) { return false; }
+    const auto remid = msg.remote_id();
+    auto mmsg = std::move(msg).toparts();
+    bool ok = decompress(mmsg);
+    msg.fromparts(std::move(mmsg));
+    msg.set_remote_id(remid);
+    return ok;
+}
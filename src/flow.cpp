@@ -3,9 +3,14 @@
 #include "zio/logging.hpp"
 #include "zio/sml.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <deque>
+#include <limits>
+#include <optional>
 #include <queue>
+#include <unordered_map>
 
 namespace zio {
 
@@ -28,8 +33,24 @@ namespace zio {
         int m_send_seqno{-1};
         int m_recv_seqno{-1};
 
+        // Credit window sizing.  Only a taker adapts, a giver follows.
+        std::optional<flow::AdaptiveCredit> m_adapt;
+        flow::CreditStats m_stats;
+        bool m_window_changed{false};  // to send with next PAY
+
         virtual std::string name() const = 0;
 
+        // Record a change of the window in the stats.
+        void note_window()
+        {
+            m_stats.window = m_total_credit;
+            if (!m_stats.max_window) {
+                m_stats.min_window = m_stats.max_window = m_total_credit;
+            }
+            m_stats.min_window = std::min(m_stats.min_window, m_total_credit);
+            m_stats.max_window = std::max(m_stats.max_window, m_total_credit);
+        }
+
         bool giver() const { return m_dir == flow::direction_e::extract; }
         bool taker() const { return m_dir == flow::direction_e::inject; }
 
@@ -105,9 +126,11 @@ namespace zio {
                           msg.label());
                 return false;
             }
-            if (got_credit + m_credit > m_total_credit) {
+            const int window = lab.window();
+            const int total = window > 0 ? window : m_total_credit;
+            if (got_credit + m_credit > total) {
                 ZIO_TRACE("[flow {}] check_pay too much PAY {} + {} > {}",
-                          name(), got_credit, m_credit, m_total_credit);
+                          name(), got_credit, m_credit, total);
                 return false;
             }
             ZIO_TRACE("[flow {}] check_pay okay with '{}'", name(),
@@ -240,9 +263,18 @@ auto recv_bot = [](auto e, zio::FlowFSM& f) { f.recv_bot(e.msg); };
 
 auto recv_pay = [](auto e, zio::FlowFSM& f) {
     ++f.m_recv_seqno;
-    zio::json fobj = e.msg.label_object();
-    int credit = fobj["credit"];
+    const zio::flow::Label lab(e.msg);
+    int credit = lab.credit();
     f.m_credit += credit;
+    const int window = lab.window();
+    if (window > 0 and window != f.m_total_credit) {
+        if (window > f.m_total_credit) { ++f.m_stats.grows; }
+        else {
+            ++f.m_stats.shrinks;
+        }
+        f.m_total_credit = window;
+        f.note_window();
+    }
     ZIO_TRACE("[flow {}] recv_pay #{} as {} with {}/{} credit", f.name(),
               f.m_recv_seqno, f.m_dir, credit, f.m_total_credit);
 };
@@ -253,10 +285,13 @@ auto flush_pay = [](auto e, zio::FlowFSM& f) {
         zio::critical("[flow {}] flush_pay no credit to flush", f.name());
         return;
     }
-    auto fobj = e.msg.label_object();
-    fobj["flow"] = "PAY";
-    fobj["credit"] = f.m_credit;
-    e.msg.set_label_object(fobj);
+    zio::flow::Label lab(e.msg);
+    lab.msgtype(zio::flow::msgtype_e::pay);
+    lab.credit(f.m_credit);
+    if (f.m_window_changed) {
+        lab.window(f.m_total_credit);
+        f.m_window_changed = false;
+    }
     e.msg.set_seqno(++f.m_send_seqno);
     ZIO_TRACE("[flow {}] flush_pay #{}, credit:{}", f.name(), f.m_send_seqno,
               f.m_credit);
@@ -422,6 +457,16 @@ namespace zio {
         timeout_t timeout;
         FlowSM sm;
 
+        // Adaptive credit measurements, see adapt().
+        int m_window_dats{0};
+        bool m_window_starved{false};
+        bool m_timing_rtt{false};
+        bool m_try_starved{false};
+        std::chrono::microseconds m_pay_time{0}, m_get_return{0};
+
+        // DAT received by pump() and not yet taken by get().
+        std::deque<zio::Message> m_held;
+
         FlowImp(zio::portptr_t p, flow::direction_e dir, int credit,
                 timeout_t tout)
             : FlowFSM(dir, credit)
@@ -505,6 +550,7 @@ namespace zio {
                 throw flow::local_error(
                     str("bot handshake failed to reach FLOW state"));
             }
+            note_window();
             ZIO_TRACE(str("bot handshake complete"));
             return true;
         }
@@ -514,7 +560,6 @@ namespace zio {
         {
             flow::Label lab(msg);
             lab.msgtype(flow::msgtype_e::eot);
-            lab.commit();
             return send(msg);
         }
 
@@ -544,14 +589,21 @@ namespace zio {
         /// Attempt to send DAT (for givers)
         bool put(zio::Message& dat)
         {
+            if (eot_recved()) {  // already seen by pump()
+                throw flow::end_of_transmission(str("flow put received EOT"));
+            }
             recv_pay();
             if (!m_credit) {  // try harder
-                zio::Message maybe_pay;
-                if (!port->recv(maybe_pay, timeout)) { return false; }
+                zio::Message maybe_pay = port->pool().acquire();
+                if (!port->recv(maybe_pay, timeout)) {
+                    port->pool().release(std::move(maybe_pay));
+                    return false;
+                }
 
                 ZIO_TRACE(str("just in time income: {}", maybe_pay.label()));
 
                 sm.process_event(RecvMsg{maybe_pay});
+                port->pool().release(std::move(maybe_pay));
                 if (sm.is(boost::sml::state<FINACK>)) {
                     throw flow::end_of_transmission(
                         str("flow get received EOT"));
@@ -560,27 +612,124 @@ namespace zio {
 
             flow::Label lab(dat);
             lab.msgtype(flow::msgtype_e::dat);
-            lab.commit();
             return send(dat);
         }
 
         /// Attempt to get DAT (for takers)
         bool get(zio::Message& dat)
         {
-            send_pay();
+            if (m_adapt) { measure_drain(); }
+            // As ready(), pay only once all held DAT are taken.
+            if (m_held.empty()) { send_pay(); }
+            if (take_held(dat)) { return true; }
+            if (eot_recved()) {  // already seen by pump()
+                throw flow::end_of_transmission(str("flow get received EOT"));
+            }
 
-            bool noto = recv(dat);
+            bool noto;
+            if (m_adapt) {
+                noto = recv(dat, timeout_t{0});
+                if (!noto) {
+                    ++m_stats.starved;
+                    m_window_starved = true;
+                    noto = recv(dat);
+                }
+            }
+            else {
+                noto = recv(dat);
+            }
             if (!noto) { return false; }
             if (sm.is(boost::sml::state<FINACK>)) {
                 throw flow::end_of_transmission(str("flow get received EOT"));
             }
+            if (m_adapt) { adapt(); }
             return true;
         }
 
+        // Smooth the time the application spends between calls to
+        // get() into a drain rate.
+        void measure_drain()
+        {
+            const auto now = zio::now_us();
+            if (m_get_return.count()) {
+                const double busy =
+                    std::max(1e-6, 1e-6 * (now - m_get_return).count());
+                const double rate = 1.0 / busy;
+                m_stats.drain = m_stats.drain > 0
+                                    ? 0.875 * m_stats.drain + 0.125 * rate
+                                    : rate;
+            }
+            m_get_return = std::chrono::microseconds{0};
+        }
+
+        // Called by a taker with each DAT got.  Once a window of DAT
+        // is counted out, grow or shrink the window.
+        void adapt()
+        {
+            const auto now = zio::now_us();
+            m_get_return = now;
+            if (m_timing_rtt) {
+                const double sample = 1e-6 * (now - m_pay_time).count();
+                m_stats.rtt = m_stats.rtt > 0
+                                  ? 0.875 * m_stats.rtt + 0.125 * sample
+                                  : sample;
+                m_timing_rtt = false;
+            }
+
+            if (++m_window_dats < m_total_credit) { return; }
+
+            const auto& ac = *m_adapt;
+            int want = m_total_credit;
+            if (m_window_starved) { want += ac.increase; }
+            else {
+                const int bdp = (int)std::ceil(m_stats.drain * m_stats.rtt) + 1;
+                want = std::max((int)(want * ac.decrease), bdp);
+            }
+            resize(std::clamp(want, ac.min_credit, ac.max_credit));
+            m_window_dats = 0;
+            m_window_starved = false;
+        }
+
+        // Change the window of a taker.  New credit is paid out at
+        // once, credit is withdrawn only as it is held.
+        void resize(int want)
+        {
+            if (want > m_total_credit) {
+                m_credit += want - m_total_credit;
+                m_total_credit = want;
+                ++m_stats.grows;
+            }
+            else if (want < m_total_credit) {
+                // keep one credit so the next PAY carries the window
+                const int less = std::min(m_total_credit - want, m_credit - 1);
+                if (less <= 0) { return; }
+                m_credit -= less;
+                m_total_credit -= less;
+                ++m_stats.shrinks;
+            }
+            else {
+                return;
+            }
+            m_window_changed = true;
+            note_window();
+            ZIO_TRACE(str("credit window now {}", m_total_credit));
+        }
+
+        void set_adaptive(const flow::AdaptiveCredit& ac)
+        {
+            if (ac.min_credit < 1 or ac.max_credit < ac.min_credit or
+                ac.max_credit > std::numeric_limits<uint16_t>::max() or
+                ac.decrease <= 0 or ac.decrease > 1 or ac.increase < 0) {
+                throw flow::local_error(str("invalid adaptive credit"));
+            }
+            if (giver()) { return; }
+            m_adapt = ac;
+        }
+
         void recv_pay()
         {
             if (m_credit == m_total_credit) { return; }
-            zio::Message maybe_pay;
+            zio::Message maybe_pay = port->pool().acquire();
             if (port->recv(maybe_pay, timeout_t{0})) {
                 ZIO_TRACE(str("income: {}", maybe_pay.label()));
 
@@ -590,19 +739,26 @@ namespace zio {
                         str("flow pay received EOT"));
                 }
             }
+            port->pool().release(std::move(maybe_pay));
         }
         void send_pay()
         {
             if (!m_credit) { return; }
-            zio::Message pay("FLOW");
+            zio::Message pay = port->pool().acquire("FLOW");
             flow::Label lab(pay);
             lab.msgtype(flow::msgtype_e::pay);
-            lab.commit();
 
+            // Time a round trip when the giver is known to be broke.
+            const bool broke = m_credit == m_total_credit;
             if (sm.process_event(FlushPay{pay})) {
                 ZIO_TRACE(str("paying: {}", pay.label()));
                 port->send(pay);
+                if (m_adapt and broke and !m_timing_rtt) {
+                    m_pay_time = zio::now_us();
+                    m_timing_rtt = true;
+                }
             }
+            port->pool().release(std::move(pay));
         }
 
         int pay()
@@ -614,10 +770,104 @@ namespace zio {
             return m_credit;
         }
 
+        bool begun() const { return m_send_seqno >= 0 and m_recv_seqno >= 0; }
+        bool eot_recved()
+        {
+            return sm.is(boost::sml::state<FINACK>) or
+                   sm.is(boost::sml::state<FIN>);
+        }
+
+        // Process every message already waiting on the port without
+        // blocking.  DAT are held for a later get().
+        void pump()
+        {
+            while (begun() and !eot_recved()) {
+                zio::Message msg = port->pool().acquire();
+                if (!port->recv(msg, timeout_t{0})) {
+                    port->pool().release(std::move(msg));
+                    return;
+                }
+                ZIO_TRACE(str("pumping: {}", msg.label()));
+                if (!sm.process_event(RecvMsg{msg})) {
+                    throw flow::remote_error(
+                        str("recv flow bad message {}", msg.label()));
+                }
+                if (flow::Label(msg).msgtype() == flow::msgtype_e::dat) {
+                    m_held.push_back(std::move(msg));
+                }
+                else {
+                    port->pool().release(std::move(msg));
+                }
+            }
+        }
+
+        bool take_held(zio::Message& dat)
+        {
+            if (m_held.empty()) { return false; }
+            std::swap(dat, m_held.front());
+            m_held.pop_front();
+            m_try_starved = false;
+            // Sample the drain only as DAT are taken, not as polled.
+            if (m_adapt) {
+                measure_drain();
+                adapt();
+            }
+            return true;
+        }
+
+        zio::event_flags ready()
+        {
+            auto ev = zio::event_flags::none;
+            if (!begun()) { return ev; }
+            // A taker pays only for DAT the application has taken.
+            if (taker() and m_held.empty()) { send_pay(); }
+            pump();
+            if (!m_held.empty() or eot_recved()) {
+                ev = ev | zio::event_flags::pollin;
+            }
+            if (giver() and m_credit > 0 and !eot_recved() and
+                !sm.is(boost::sml::state<ACKFIN>)) {
+                ev = ev | zio::event_flags::pollout;
+            }
+            return ev;
+        }
+
+        bool try_put(zio::Message& dat)
+        {
+            if (!m_credit) { pump(); }
+            if (eot_recved()) {
+                throw flow::end_of_transmission(str("flow put received EOT"));
+            }
+            if (!m_credit) { return false; }
+            flow::Label lab(dat);
+            lab.msgtype(flow::msgtype_e::dat);
+            return send(dat);
+        }
+
+        bool try_get(zio::Message& dat)
+        {
+            if (m_held.empty()) {
+                send_pay();
+                pump();
+            }
+            if (take_held(dat)) { return true; }
+            if (eot_recved()) {
+                throw flow::end_of_transmission(str("flow get received EOT"));
+            }
+            // Count each wait for DAT once however often it is polled.
+            if (m_adapt and !m_try_starved) {
+                ++m_stats.starved;
+                m_window_starved = true;
+                m_try_starved = true;
+            }
+            return false;
+        }
+
         // Try to do a flow level recv and process it throught the SM
-        bool recv(zio::Message& msg)
+        bool recv(zio::Message& msg) { return recv(msg, timeout); }
+        bool recv(zio::Message& msg, timeout_t tout)
         {
-            if (!port->recv(msg, timeout)) {
+            if (!port->recv(msg, tout)) {
                 return false;  // timeout
             }
 
@@ -673,7 +923,6 @@ namespace zio {
             else {
                 lab.direction(flow::direction_e::inject);
             }
-            lab.commit();
 
             if (!send(botmsg)) { return false; }
             return true;
@@ -705,7 +954,6 @@ namespace zio {
             lab.msgtype(flow::msgtype_e::bot);
             lab.direction(m_dir);
             lab.credit(m_total_credit);
-            lab.commit();
 
             if (!send(botmsg)) { return false; }
             if (!sm.is(boost::sml::state<BOTSEND>)) {
@@ -726,6 +974,304 @@ namespace zio {
 
 }  // namespace zio
 
+namespace zio {
+
+    // One flow of a FlowServer.  Messages are given to it by the
+    // server rather than received from a port.
+    struct FlowChannel : public FlowFSM
+    {
+        std::string m_name;
+        FlowSM sm;
+        zio::Message bot;
+        std::deque<zio::Message> dats;  // received, not yet got
+        bool accepted{false};
+        bool eot_recv{false};
+        bool eot_sent{false};
+        bool credited{false};  // credit arrived since last reported
+
+        FlowChannel(const std::string& name, flow::direction_e dir,
+                    int credit)
+            : FlowFSM(dir, credit)
+            , m_name{name}
+            , sm{(FlowFSM&)*this}
+        {
+        }
+        virtual ~FlowChannel() {}
+
+        virtual std::string name() const { return m_name; }
+
+        virtual int accept_credit(int offer_credit)
+        {
+            // As FlowImpServer, a client may only shrink the credit.
+            if (offer_credit > 0 and offer_credit < m_total_credit) {
+                m_total_credit = offer_credit;
+            }
+            return m_total_credit;
+        }
+
+        int events() const
+        {
+            int ev = 0;
+            if (!accepted) { ev |= FlowServer::botready; }
+            if (!dats.empty()) { ev |= FlowServer::readable; }
+            if (credited and m_credit > 0 and !eot_recv and !eot_sent) {
+                ev |= FlowServer::writable;
+            }
+            if (eot_recv and !eot_sent) { ev |= FlowServer::eotready; }
+            return ev;
+        }
+    };
+
+    struct FlowServerImp
+    {
+        zio::portptr_t port;
+        int credit;
+        std::unordered_map<remote_identity_t, std::unique_ptr<FlowChannel>>
+            flows;
+        std::vector<zio::Message> msgs;  // reused by poll()
+        std::vector<remote_identity_t> ended;
+
+        // At most this many messages are processed per poll().
+        static const size_t max_batch = 1000;
+
+        FlowServerImp(zio::portptr_t p, int cred)
+            : port{p}
+            , credit{cred}
+        {
+        }
+
+        FlowChannel& at(const remote_identity_t& remid) const
+        {
+            auto it = flows.find(remid);
+            if (it == flows.end()) {
+                throw flow::local_error(
+                    fmt::format("[flowserver {}] unknown flow #{}",
+                                port->name(), to_rid(remid)));
+            }
+            return *it->second;
+        }
+
+        void dispatch(zio::Message& msg)
+        {
+            const auto remid = msg.remote_id();
+            auto it = flows.find(remid);
+            if (it == flows.end()) {
+                begin(msg);
+                return;
+            }
+            auto& ch = *it->second;
+            if (!ch.sm.process_event(RecvMsg{msg})) {
+                zio::warn("[flow {}] drop bad message {}", ch.name(),
+                          flow::Label(msg).str());
+                return;
+            }
+            if (ch.sm.is(boost::sml::state<FIN>)) {
+                flows.erase(it);
+                ended.push_back(remid);
+                return;
+            }
+            if (ch.sm.is(boost::sml::state<FINACK>)) {
+                ch.eot_recv = true;
+                return;
+            }
+            const auto mt = flow::Label(msg).msgtype();
+            if (mt == flow::msgtype_e::dat) {
+                ch.dats.emplace_back();
+                std::swap(ch.dats.back(), msg);
+            }
+            else if (mt == flow::msgtype_e::pay and ch.accepted and
+                     ch.giver()) {
+                ch.credited = true;
+            }
+        }
+
+        // A message from an unknown client must be a BOT.
+        void begin(zio::Message& msg)
+        {
+            const flow::Label lab(msg);
+            const std::string name =
+                fmt::format("{}#{}", port->name(), to_rid(msg.remote_id()));
+            auto dir = flow::direction_e::unknown;
+            if (lab.direction() == flow::direction_e::inject) {
+                dir = flow::direction_e::extract;
+            }
+            else if (lab.direction() == flow::direction_e::extract) {
+                dir = flow::direction_e::inject;
+            }
+            if (lab.msgtype() != flow::msgtype_e::bot or
+                dir == flow::direction_e::unknown) {
+                zio::warn("[flow {}] drop message of unknown flow {}", name,
+                          lab.str());
+                return;
+            }
+            auto ch = std::make_unique<FlowChannel>(name, dir, credit);
+            if (!ch->sm.process_event(RecvMsg{msg})) {
+                zio::warn("[flow {}] drop bad BOT {}", name, lab.str());
+                return;
+            }
+            std::swap(ch->bot, msg);
+            flows.emplace(ch->m_remid, std::move(ch));
+        }
+
+        bool send(FlowChannel& ch, zio::Message& msg)
+        {
+            msg.set_form("FLOW");
+            if (!ch.sm.process_event(SendMsg{msg})) {
+                throw flow::local_error(fmt::format(
+                    "[flow {}] send invalid: {}", ch.name(),
+                    flow::Label(msg).str()));
+            }
+            return port->send(msg);
+        }
+
+        void send_pay(FlowChannel& ch)
+        {
+            if (!ch.m_credit) { return; }
+            zio::Message pay = port->pool().acquire("FLOW");
+            flow::Label lab(pay);
+            lab.msgtype(flow::msgtype_e::pay);
+            if (ch.sm.process_event(FlushPay{pay})) { port->send(pay); }
+            port->pool().release(std::move(pay));
+        }
+    };
+}  // namespace zio
+
+zio::FlowServer::FlowServer(zio::portptr_t port, int credit)
+{
+    if (!zio::is_serverish(port->socket())) {
+        throw flow::local_error("flow server given non-server port");
+    }
+    imp = std::make_unique<FlowServerImp>(port, credit);
+}
+
+zio::FlowServer::~FlowServer() = default;
+
+size_t zio::FlowServer::poll(std::vector<Event>& events, timeout_t timeout)
+{
+    events.clear();
+    bool waiting = !imp->ended.empty();
+    for (const auto& [remid, ch] : imp->flows) {
+        if (ch->events()) {
+            waiting = true;
+            break;
+        }
+    }
+
+    const size_t nmsgs = imp->port->recv_many(
+        imp->msgs, FlowServerImp::max_batch, waiting ? timeout_t{0} : timeout);
+    for (size_t ind = 0; ind < nmsgs; ++ind) { imp->dispatch(imp->msgs[ind]); }
+
+    for (const auto& remid : imp->ended) { events.push_back({remid, ended}); }
+    imp->ended.clear();
+    for (const auto& [remid, ch] : imp->flows) {
+        const int ev = ch->events();
+        if (ev) { events.push_back({remid, ev}); }
+        ch->credited = false;
+    }
+    return events.size();
+}
+
+size_t zio::FlowServer::size() const { return imp->flows.size(); }
+
+const zio::Message& zio::FlowServer::botmsg(
+    const remote_identity_t& remid) const
+{
+    return imp->at(remid).bot;
+}
+
+bool zio::FlowServer::accept(const remote_identity_t& remid)
+{
+    return accept(remid, imp->at(remid).bot);
+}
+
+bool zio::FlowServer::accept(const remote_identity_t& remid,
+                             zio::Message& reply)
+{
+    auto& ch = imp->at(remid);
+    if (ch.accepted) {
+        throw flow::local_error(
+            fmt::format("[flow {}] BOT already accepted", ch.name()));
+    }
+    flow::Label lab(reply);
+    lab.msgtype(flow::msgtype_e::bot);
+    lab.direction(ch.m_dir);
+    lab.credit(ch.m_total_credit);
+    if (!imp->send(ch, reply)) {
+        // The state machine has sent its BOT and can not go back.
+        imp->flows.erase(remid);
+        return false;
+    }
+    if (!ch.sm.process_event(BeginFlow{})) {
+        throw flow::local_error(
+            fmt::format("[flow {}] BOT failed to begin flow", ch.name()));
+    }
+    ch.accepted = true;
+    ch.credited = ch.giver();
+    ch.note_window();
+    if (ch.taker()) { imp->send_pay(ch); }
+    return true;
+}
+
+void zio::FlowServer::reject(const remote_identity_t& remid)
+{
+    imp->flows.erase(remid);
+}
+
+zio::flow::direction_e zio::FlowServer::direction(
+    const remote_identity_t& remid) const
+{
+    return imp->at(remid).m_dir;
+}
+
+int zio::FlowServer::credit(const remote_identity_t& remid) const
+{
+    return imp->at(remid).m_credit;
+}
+
+bool zio::FlowServer::get(const remote_identity_t& remid, zio::Message& dat)
+{
+    auto& ch = imp->at(remid);
+    if (ch.dats.empty()) { return false; }
+    std::swap(dat, ch.dats.front());
+    ch.dats.pop_front();
+    // Pay back only what the application has taken.
+    if (ch.dats.empty() and !ch.eot_recv) { imp->send_pay(ch); }
+    return true;
+}
+
+bool zio::FlowServer::put(const remote_identity_t& remid, zio::Message& dat)
+{
+    auto& ch = imp->at(remid);
+    if (!ch.accepted or !ch.giver()) {
+        throw flow::local_error(
+            fmt::format("[flow {}] put to flow not giving", ch.name()));
+    }
+    if (!ch.m_credit) { return false; }
+    flow::Label lab(dat);
+    lab.msgtype(flow::msgtype_e::dat);
+    return imp->send(ch, dat);
+}
+
+bool zio::FlowServer::eot(const remote_identity_t& remid)
+{
+    zio::Message msg("FLOW");
+    return eot(remid, msg);
+}
+
+bool zio::FlowServer::eot(const remote_identity_t& remid, zio::Message& msg)
+{
+    auto& ch = imp->at(remid);
+    flow::Label lab(msg);
+    lab.msgtype(flow::msgtype_e::eot);
+    const bool ok = imp->send(ch, msg);
+    ch.eot_sent = true;
+    if (ch.sm.is(boost::sml::state<FIN>)) {
+        imp->flows.erase(remid);
+        imp->ended.push_back(remid);
+    }
+    return ok;
+}
+
 static std::unique_ptr<zio::FlowImp> make_imp(zio::portptr_t p,
                                               zio::flow::direction_e dir,
                                               int credit,
@@ -756,6 +1302,16 @@ zio::Flow& zio::Flow::operator=(zio::Flow&& rhs) = default;
 void zio::Flow::set_timeout(timeout_t timeout) { imp->timeout = timeout; }
 int zio::Flow::credit() const { return imp->m_credit; }
 int zio::Flow::total_credit() const { return imp->m_total_credit; }
+void zio::Flow::set_adaptive(const flow::AdaptiveCredit& adapt)
+{
+    imp->set_adaptive(adapt);
+}
+zio::flow::CreditStats zio::Flow::credit_stats() const
+{
+    auto stats = imp->m_stats;
+    stats.window = imp->m_total_credit;
+    return stats;
+}
 bool zio::Flow::bot()
 {
     zio::Message msg("FLOW");
@@ -780,33 +1336,63 @@ bool zio::Flow::eot(zio::Message& msg) { return imp->eot(msg); }
 bool zio::Flow::put(zio::Message& msg) { return imp->put(msg); }
 bool zio::Flow::get(zio::Message& msg) { return imp->get(msg); }
 
+bool zio::Flow::try_put(zio::Message& msg) { return imp->try_put(msg); }
+bool zio::Flow::try_get(zio::Message& msg) { return imp->try_get(msg); }
+zio::event_flags zio::Flow::ready() { return imp->ready(); }
+zio::socket_t& zio::Flow::socket() { return imp->port->socket(); }
+
 int zio::Flow::pay() { return imp->pay(); }
 
 bool zio::Flow::recv(zio::Message& msg) { return imp->recv(msg); }
 
 bool zio::Flow::send(zio::Message& msg) { return imp->send(msg); }
 
-zio::flow::Label::Label(zio::Message& msg)
-    : m_msg(msg)
-    , m_fobj(msg.label_object())
+zio::flow::Label::Label(zio::Message& msg) : m_msg(msg) {}
+
+// Messages from older peers carry the flow attributes in the label
+// object.  They are read from there only if the binary fields are
+// absent.
+static const zio::json* json_fields(const zio::Message& msg)
 {
+    const auto& fobj = msg.label_object();
+    if (!fobj.is_object() or !fobj.contains("flow")) { return nullptr; }
+    return &fobj;
 }
-zio::flow::Label::~Label() { commit(); }
-void zio::flow::Label::commit()
+
+zio::FlowHeader& zio::flow::Label::fields()
 {
-    if (m_dirty) {
-        m_msg.set_label_object(m_fobj);
-        m_dirty = false;
-    }
+    auto& fh = m_msg.flow();
+    if (!fh.empty() or !json_fields(m_msg)) { return fh; }
+
+    // Move the attributes to the binary fields before changing any.
+    fh.direction = enumind(direction());
+    fh.credit = credit();
+    fh.window = window();
+    fh.msgtype = enumind(msgtype());
+    auto& fobj = m_msg.label_object_ref();
+    fobj.erase("flow");
+    fobj.erase("direction");
+    fobj.erase("credit");
+    fobj.erase("window");
+    return fh;
 }
+
 zio::flow::direction_e zio::flow::Label::direction() const
 {
-    if (!m_fobj.is_object()) { return direction_e::unknown; }
-    const auto jit = m_fobj.find("direction");
-    if (jit == m_fobj.end()) { return direction_e::unknown; }
-    const auto jdir = *jit;
+    const auto& fh = m_msg.flow();
+    if (!fh.empty()) {
+        if (fh.direction > enumind(direction_e::extract)) {
+            return direction_e::unknown;
+        }
+        return (direction_e)fh.direction;
+    }
+    const auto* fobj = json_fields(m_msg);
+    if (!fobj) { return direction_e::unknown; }
+    const auto jit = fobj->find("direction");
+    if (jit == fobj->end()) { return direction_e::unknown; }
+    const auto& jdir = *jit;
     if (!jdir.is_string()) { return direction_e::unknown; }
-    std::string dir = jdir.get<std::string>();
+    const auto& dir = jdir.get_ref<const std::string&>();
     if (dir == "inject") { return direction_e::inject; }
     if (dir == "extract") { return direction_e::extract; }
     return direction_e::unknown;
@@ -814,28 +1400,21 @@ zio::flow::direction_e zio::flow::Label::direction() const
 
 void zio::flow::Label::direction(zio::flow::direction_e dir)
 {
-    switch (dir) {
-        case direction_e::inject:
-            m_fobj["direction"] = "inject";
-            break;
-        case direction_e::extract:
-            m_fobj["direction"] = "extract";
-            break;
-        case direction_e::unknown:
-            m_fobj.erase("direction");
-            break;
-    }
-    m_dirty = true;
+    fields().direction = enumind(dir);
 }
 
 zio::flow::msgtype_e zio::flow::Label::msgtype() const
 {
-    if (!m_fobj.is_object()) { return msgtype_e::unknown; }
-    const auto jit = m_fobj.find("flow");
-    if (jit == m_fobj.end()) { return msgtype_e::unknown; }
-    const auto jtyp = *jit;
+    const auto& fh = m_msg.flow();
+    if (!fh.empty()) {
+        if (fh.msgtype > enumind(msgtype_e::eot)) { return msgtype_e::unknown; }
+        return (msgtype_e)fh.msgtype;
+    }
+    const auto* fobj = json_fields(m_msg);
+    if (!fobj) { return msgtype_e::unknown; }
+    const auto& jtyp = (*fobj)["flow"];
     if (!jtyp.is_string()) { return msgtype_e::unknown; }
-    std::string typ = jtyp.get<std::string>();
+    const auto& typ = jtyp.get_ref<const std::string&>();
     if (typ == "BOT") { return msgtype_e::bot; }
     if (typ == "DAT") { return msgtype_e::dat; }
     if (typ == "PAY") { return msgtype_e::pay; }
@@ -844,42 +1423,39 @@ zio::flow::msgtype_e zio::flow::Label::msgtype() const
 }
 void zio::flow::Label::msgtype(zio::flow::msgtype_e typ)
 {
-    switch (typ) {
-        case zio::flow::msgtype_e::bot:
-            m_fobj["flow"] = "BOT";
-            break;
-        case zio::flow::msgtype_e::dat:
-            m_fobj["flow"] = "DAT";
-            break;
-        case zio::flow::msgtype_e::pay:
-            m_fobj["flow"] = "PAY";
-            break;
-        case zio::flow::msgtype_e::eot:
-            m_fobj["flow"] = "EOT";
-            break;
-        case zio::flow::msgtype_e::unknown:
-            m_fobj.erase("flow");
-            break;
-    }
-    m_dirty = true;
+    fields().msgtype = enumind(typ);
 }
 int zio::flow::Label::credit() const
 {
-    if (!m_fobj.is_object()) { return -1; }
-    const auto jit = m_fobj.find("credit");
-    if (jit == m_fobj.end()) { return -1; }
-    const auto jtyp = *jit;
+    const auto& fh = m_msg.flow();
+    if (!fh.empty()) { return fh.credit < 0 ? -1 : fh.credit; }
+    const auto* fobj = json_fields(m_msg);
+    if (!fobj) { return -1; }
+    const auto jit = fobj->find("credit");
+    if (jit == fobj->end()) { return -1; }
+    const auto& jtyp = *jit;
     if (!jtyp.is_number()) { return -1; }
     return jtyp.get<int>();
 }
 void zio::flow::Label::credit(int cred)
 {
-    if (cred < 0) {
-        m_fobj.erase("credit");
-        return;
-    }
-    m_fobj["credit"] = cred;
-    m_dirty = true;
+    fields().credit = cred < 0 ? -1 : cred;
+}
+
+int zio::flow::Label::window() const
+{
+    const auto& fh = m_msg.flow();
+    if (!fh.empty()) { return fh.window; }
+    const auto* fobj = json_fields(m_msg);
+    if (!fobj) { return 0; }
+    const auto jit = fobj->find("window");
+    if (jit == fobj->end() or !jit->is_number()) { return 0; }
+    return jit->get<int>();
+}
+void zio::flow::Label::window(int win)
+{
+    const int most = std::numeric_limits<uint16_t>::max();
+    fields().window = std::clamp(win, 0, most);
 }
 
 std::string zio::flow::Label::str() const
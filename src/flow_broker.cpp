@@ -0,0 +1,123 @@
+#include "zio/flow/broker.hpp"
+#include "zio/util.hpp"
+#include "zio/logging.hpp"
+
+using namespace zio::flow;
+
+// At most this many messages are routed per poll().
+static const size_t max_batch = 1000;
+
+static direction_e reversed(direction_e dir)
+{
+    if (dir == direction_e::inject) { return direction_e::extract; }
+    if (dir == direction_e::extract) { return direction_e::inject; }
+    return direction_e::unknown;
+}
+
+Broker::Broker(zio::portptr_t server, factory_t factory)
+    : m_port(server)
+    , m_factory(factory)
+{
+    // The "cid" carries a SERVER routing ID, ROUTER identities differ.
+    if (m_port->socket().get(zmq::sockopt::type) != ZMQ_SERVER) {
+        throw std::runtime_error("zio::flow::Broker requires SERVER port");
+    }
+}
+
+size_t Broker::poll(timeout_t timeout)
+{
+    const size_t nmsgs = m_port->recv_many(m_msgs, max_batch, timeout);
+    for (size_t ind = 0; ind < nmsgs; ++ind) { route(m_msgs[ind]); }
+    return nmsgs;
+}
+
+void Broker::route(zio::Message& msg)
+{
+    const remote_identity_t rid = msg.remote_id();
+    auto it = m_routes.find(rid);
+    if (it != m_routes.end()) {
+        auto& here = it->second;
+        const remote_identity_t other = here.other;
+        if (Label(msg).msgtype() == msgtype_e::eot) {
+            here.eot = true;
+            auto oit = m_routes.find(other);
+            if (oit == m_routes.end() or oit->second.eot) {
+                m_routes.erase(it);
+                m_routes.erase(other);
+            }
+        }
+        msg.set_remote_id(other);
+        m_port->send(std::move(msg));
+        return;
+    }
+
+    // A new client or handler.
+    Label lab(msg);
+    if (lab.msgtype() != msgtype_e::bot) {
+        zio::warn("[broker {}] drop non-BOT from unknown #{}: {}",
+                  m_port->name(), zio::to_rid(rid), lab.str());
+        return;
+    }
+    const auto& fobj = lab.object();
+    if (fobj.is_object()) {
+        const auto cit = fobj.find("cid");
+        if (cit != fobj.end() and cit->is_number_unsigned()) {
+            from_handler(msg, zio::to_remid(cit->get<uint32_t>()));
+            return;
+        }
+    }
+    from_client(msg);
+}
+
+void Broker::from_client(zio::Message& msg)
+{
+    const remote_identity_t rid = msg.remote_id();
+    Label lab(msg);
+    const auto dir = reversed(lab.direction());
+    if (dir == direction_e::unknown) {
+        zio::warn("[broker {}] drop BOT without direction from #{}",
+                  m_port->name(), zio::to_rid(rid));
+        return;
+    }
+    lab.direction(dir);
+    lab.object()["cid"] = zio::to_rid(rid);
+    msg.set_remote_id(remote_identity_t{});
+    ZIO_DEBUG("[broker {}] BOT from client #{} to factory", m_port->name(),
+              zio::to_rid(rid));
+    if (m_factory(msg)) {
+        m_waiting.insert(rid);
+        return;
+    }
+
+    zio::warn("[broker {}] factory rejects client #{}", m_port->name(),
+              zio::to_rid(rid));
+    zio::Message eot("FLOW");
+    Label(eot).msgtype(msgtype_e::eot);
+    eot.set_remote_id(rid);
+    m_port->send(eot);
+}
+
+void Broker::from_handler(zio::Message& msg, remote_identity_t cid)
+{
+    const remote_identity_t rid = msg.remote_id();
+    if (!m_waiting.erase(cid)) {
+        zio::warn("[broker {}] drop BOT from handler #{} for unknown #{}",
+                  m_port->name(), zio::to_rid(rid), zio::to_rid(cid));
+        return;
+    }
+    m_routes[rid] = Route{cid};
+    m_routes[cid] = Route{rid};
+    ZIO_DEBUG("[broker {}] pair client #{} with handler #{}", m_port->name(),
+              zio::to_rid(cid), zio::to_rid(rid));
+
+    // The client sees the handler's BOT as a server's reply.
+    Label lab(msg);
+    lab.object().erase("cid");
+    msg.set_remote_id(cid);
+    m_port->send(msg);
+
+    // And the handler sees the client's direction.
+    lab.direction(reversed(lab.direction()));
+    msg.set_remote_id(rid);
+    m_port->send(std::move(msg));
+}
@@ -2,7 +2,8 @@
 #include "zio/exceptions.hpp"
 #include "zio/logging.hpp"
 #include <czmq.h>
-#include <sstream>
+#include <algorithm>
+#include <cstring>
 #include <chrono>
 
 const char* zio::level::name(zio::level::MessageLevel lvl)
@@ -13,31 +14,134 @@ const char* zio::level::name(zio::level::MessageLevel lvl)
     return level_names[lvl];
 }
 
+zio::label_encoding_e zio::label_encoding(const std::string_view& label)
+{
+    if (label.empty()) { return label_encoding_e::json; }
+    const uint8_t marker = label[0];
+    if (marker == enumind(label_encoding_e::cbor)) {
+        return label_encoding_e::cbor;
+    }
+    if (marker == enumind(label_encoding_e::msgpack)) {
+        return label_encoding_e::msgpack;
+    }
+    return label_encoding_e::json;
+}
+
+std::string zio::dump_label(const zio::json& lobj, label_encoding_e enc)
+{
+    if (enc == label_encoding_e::json) { return lobj.dump(); }
+
+    std::string ret(1, (char)enumind(enc));
+    if (enc == label_encoding_e::cbor) { json::to_cbor(lobj, ret); }
+    else {
+        json::to_msgpack(lobj, ret);
+    }
+    return ret;
+}
+
+zio::json zio::load_label(const std::string_view& label)
+{
+    if (label.empty()) { return nullptr; }
+    try {
+        switch (label_encoding(label)) {
+            case label_encoding_e::cbor:
+                return json::from_cbor(label.begin() + 1, label.end());
+            case label_encoding_e::msgpack:
+                return json::from_msgpack(label.begin() + 1, label.end());
+            case label_encoding_e::json:
+                break;
+        }
+        return json::parse(label.begin(), label.end());
+    } catch (const json::parse_error&) {
+        return nullptr;
+    }
+}
+
+bool zio::PrefixHeaderView::loads(const void* data, size_t size)
+{
+    if (size < 8) return false;
+    const char* p = static_cast<const char*>(data);
+    if (p[0] != 'Z' or p[1] != 'I' or p[2] != 'O') return false;
+    level = static_cast<zio::level::MessageLevel>(p[3] - '0');
+    form = std::string_view(p + 4, 4);
+    label = std::string_view(p + 8, size - 8);
+    return true;
+}
+
+size_t zio::PrefixHeader::dump(void* buf) const
+{
+    char* p = static_cast<char*>(buf);
+    p[0] = 'Z';
+    p[1] = 'I';
+    p[2] = 'O';
+    p[3] = '0' + level;
+    // form is kept at length 4 but guard against direct assignment
+    const size_t nform = std::min(form.size(), (size_t)4);
+    memcpy(p + 4, form.data(), nform);
+    memset(p + 4 + nform, ' ', 4 - nform);
+    memcpy(p + 8, label.data(), label.size());
+    return size();
+}
+
+void zio::PrefixHeader::dump(zio::message_t& part) const
+{
+    const size_t siz = size();
+    if (part.size() != siz) { part.rebuild(siz); }
+    dump(part.data());
+}
+
 std::string zio::PrefixHeader::dumps() const
 {
-    std::stringstream ss;
-    char num = '0' + level;
-    ss << "ZIO" << num << form;
-    if (label.size() > 0) { ss << label; }
-    return ss.str();
+    std::string ret(size(), ' ');
+    dump(ret.data());
+    return ret;
+}
+
+void zio::PrefixHeader::loads(const zio::PrefixHeaderView& view)
+{
+    level = view.level;
+    form.assign(view.form.data(), view.form.size());
+    label.assign(view.label.data(), view.label.size());
 }
 
 bool zio::PrefixHeader::loads(const std::string& p)
 {
-    const size_t siz = p.size();
-    if (siz < 8) return false;
-    if (p.substr(0, 3) != "ZIO") return false;
-    level = static_cast<zio::level::MessageLevel>(p[3] - '0');
-    form = p.substr(4, 4);
-    label = p.substr(8);
+    PrefixHeaderView view;
+    if (!view.loads(p.data(), p.size())) return false;
+    loads(view);
     return true;
 }
 
+// The coord header part holds the flow fields after the coordinates
+// only if they are set.  This breaks the wire format for FLOW
+// messages: readers predating the flow fields reject (Python) or
+// misread (C++) a coord part longer than 24 bytes, so both peers of
+// a flow must run this version.
+namespace {
+    struct CoordFlow
+    {
+        zio::CoordHeader coord;
+        zio::FlowHeader flow;
+    };
+    static_assert(sizeof(CoordFlow) ==
+                      sizeof(zio::CoordHeader) + sizeof(zio::FlowHeader),
+                  "coord part must not be padded");
+
+    void add_coord(zio::multipart_t& mpmsg, const zio::CoordHeader& coord,
+                   const zio::FlowHeader& flow)
+    {
+        if (flow.empty()) { mpmsg.addtyp(coord); }
+        else {
+            mpmsg.addtyp(CoordFlow{coord, flow});
+        }
+    }
+}  // namespace
+
 zio::Message::Message() : m_remid("") {}
 
 zio::Message::Message(const header_t h, multipart_t&& pl)
     : m_header(h)
-    , m_payload(std::move(pl))
+    , m_payload(std::make_unique<multipart_t>(std::move(pl)))
     , m_remid("")
 {
 }
@@ -62,21 +166,81 @@ void zio::Message::set_level(level::MessageLevel level)
 void zio::Message::set_label(const std::string& label)
 {
     m_header.prefix.label = label;
+    label_changed();
 }
 
-zio::json zio::Message::label_object() const
+void zio::Message::label_changed()
 {
-    const std::string lab = label();
-    if (lab.size() == 0) { return nullptr; }
-    try {
-        return json::parse(lab);
-    } catch (const json::parse_error&) {
-        return nullptr;
+    m_lobj_valid = false;
+    m_label_dirty = false;
+}
+
+const zio::json& zio::Message::label_object() const
+{
+    if (m_lobj_valid) { return m_lobj; }
+    m_lobj_valid = true;
+    m_lobj = load_label(m_header.prefix.label);
+    return m_lobj;
+}
+
+// True if the label is empty or decodes, even to a null.
+static bool label_decodes(const std::string& label)
+{
+    if (label.empty()) { return true; }
+    switch (zio::label_encoding(label)) {
+        case zio::label_encoding_e::cbor:
+            return !zio::json::from_cbor(label.begin() + 1, label.end(),
+                                         true, false)
+                        .is_discarded();
+        case zio::label_encoding_e::msgpack:
+            return !zio::json::from_msgpack(label.begin() + 1, label.end(),
+                                            true, false)
+                        .is_discarded();
+        case zio::label_encoding_e::json:
+            break;
     }
+    return zio::json::accept(label.begin(), label.end());
 }
+
+zio::json& zio::Message::label_object_ref()
+{
+    // Marking dirty would replace a text label with "null".
+    if (label_object().is_null() and !m_label_dirty and
+        !label_decodes(m_header.prefix.label)) {
+        throw std::runtime_error("zio::Message: label is not JSON");
+    }
+    m_label_dirty = true;
+    return m_lobj;
+}
+
 void zio::Message::set_label_object(const zio::json& lobj)
 {
-    set_label(lobj.dump());
+    m_lobj = lobj;
+    m_lobj_valid = true;
+    m_label_dirty = true;
+}
+
+void zio::Message::set_label_object(zio::json&& lobj)
+{
+    m_lobj = std::move(lobj);
+    m_lobj_valid = true;
+    m_label_dirty = true;
+}
+
+void zio::Message::set_label_encoding(label_encoding_e enc)
+{
+    if (enc == m_label_encoding) { return; }
+    m_label_encoding = enc;
+    if (label_object().is_object()) { m_label_dirty = true; }
+}
+
+const zio::PrefixHeader& zio::Message::prefix() const
+{
+    if (m_label_dirty) {
+        m_header.prefix.label = dump_label(m_lobj, m_label_encoding);
+        m_label_dirty = false;
+    }
+    return m_header.prefix;
 }
 
 std::string zio::Message::form() const { return m_header.prefix.form; }
@@ -89,7 +253,7 @@ void zio::Message::set_form(const std::string& form)
         m_header.prefix.form[ind] = form[ind];
     }
 }
-std::string zio::Message::label() const { return m_header.prefix.label; }
+std::string zio::Message::label() const { return prefix().label; }
 
 void zio::Message::set_coord(origin_t origin, granule_t gran)
 {
@@ -104,8 +268,20 @@ void zio::Message::set_coord(origin_t origin, granule_t gran)
 
 zio::message_t zio::Message::encode() const
 {
-    auto mmsg = toparts();
-    auto spmsg = mmsg.encode();
+    // Encode directly from our parts to avoid an intermediate copy
+    // into a multipart.
+    const std::string p = prefix().dumps();
+    const CoordFlow cf{m_header.coord, m_header.flow};
+    std::vector<zio::const_buffer> bufs;
+    const auto& payload = this->payload();
+    bufs.reserve(2 + payload.size());
+    bufs.emplace_back(p.data(), p.size());
+    bufs.emplace_back(&cf, m_header.flow.empty() ? sizeof(CoordHeader)
+                                                 : sizeof(CoordFlow));
+    for (const auto& spmsg : payload) {
+        bufs.emplace_back(spmsg.data(), spmsg.size());
+    }
+    auto spmsg = zio::encode(bufs);
     auto rid = to_rid(m_remid);
     if (rid > 0) { spmsg.set_routing_id(rid); }
     return spmsg;
@@ -117,41 +293,196 @@ void zio::Message::decode(const zio::message_t& data)
     m_remid = to_remid(data.routing_id());
 }
 
-zio::multipart_t zio::Message::toparts() const
+void zio::Message::decode(zio::message_t&& data)
+{
+    const uint32_t rid = data.routing_id();
+    zio::multipart_t mmsg;
+    zio::decode_adopt(std::move(data), mmsg);
+    fromparts(std::move(mmsg));
+    m_remid = to_remid(rid);
+}
+
+zio::multipart_t zio::Message::toparts() const&
+{
+    zio::multipart_t mpmsg;
+    toparts(mpmsg);
+    return mpmsg;
+}
+
+zio::multipart_t zio::Message::toparts() &&
 {
     zio::multipart_t mpmsg;
+    std::move(*this).toparts(mpmsg);
+    return mpmsg;
+}
 
-    std::string p = m_header.prefix.dumps();
-    mpmsg.addmem(p.data(), p.size());
-    mpmsg.addtyp(m_header.coord);
-    for (const auto& spmsg : m_payload) {
+void zio::Message::toparts(zio::multipart_t& mpmsg) const&
+{
+    mpmsg.clear();
+    const auto& ph = prefix();
+    zio::message_t p(ph.size());
+    ph.dump(p.data());
+    mpmsg.add(std::move(p));
+    add_coord(mpmsg, m_header.coord, m_header.flow);
+    for (const auto& spmsg : payload()) {
         mpmsg.addmem(spmsg.data(), spmsg.size());
     }
-    return mpmsg;
 }
 
-void zio::Message::fromparts(const zio::multipart_t& mpmsg)
+void zio::Message::toparts(zio::multipart_t& mpmsg) &&
+{
+    mpmsg.clear();
+    const auto& ph = prefix();
+    zio::message_t p(ph.size());
+    ph.dump(p.data());
+    mpmsg.add(std::move(p));
+    add_coord(mpmsg, m_header.coord, m_header.flow);
+    if (!m_payload) { return; }
+    // Move by index, not by pop(), so neither container gives up
+    // its memory.
+    for (size_t ind = 0; ind < m_payload->size(); ++ind) {
+        mpmsg.add(std::move((*m_payload)[ind]));
+    }
+    m_payload->clear();
+}
+
+void zio::Message::load_headers(const zio::multipart_t& mpmsg)
 {
-    m_remid = "";
     const size_t nparts = mpmsg.size();
 
     const auto& m0 = mpmsg[0];
-    std::string p(static_cast<const char*>(m0.data()), m0.size());
-    bool ok = m_header.prefix.loads(p);
+    PrefixHeaderView view;
+    bool ok = view.loads(m0);
     if (!ok) {
+        std::string p(static_cast<const char*>(m0.data()), m0.size());
         zio::warn("part 0/{} is {} of size {}", nparts, p, m0.size());
         for (size_t ind = 0; ind < m0.size(); ++ind) {
             zio::warn("char {} = {} ({})", ind, p[ind], (int)p[ind]);
         }
         throw std::runtime_error("failed to parse prefix from parts");
     }
+    m_header.prefix.loads(view);
+    label_changed();
+    m_label_encoding = zio::label_encoding(view.label);
 
     const auto& m1 = mpmsg[1];
     m_header.coord = *m1.data<zio::CoordHeader>();
+    m_header.flow = FlowHeader{};
+    if (m1.size() >= sizeof(CoordFlow)) {
+        m_header.flow = m1.data<CoordFlow>()->flow;
+    }
+}
+
+void zio::Message::fromparts(const zio::multipart_t& mpmsg)
+{
+    m_remid = "";
+    load_headers(mpmsg);
 
-    m_payload.clear();
+    const size_t nparts = mpmsg.size();
+    auto& payload = parts();
+    payload.clear();
     for (size_t ind = 2; ind < nparts; ++ind) {
         const auto& m = mpmsg[ind];
-        m_payload.addmem(m.data(), m.size());
+        payload.addmem(m.data(), m.size());
+    }
+}
+
+void zio::Message::fromparts(zio::multipart_t&& mpmsg)
+{
+    m_remid = "";
+    load_headers(mpmsg);
+
+    // Move by index, skipping the headers, and clear rather than
+    // pop() so both containers keep their memory.
+    auto& payload = parts();
+    payload.clear();
+    for (size_t ind = 2; ind < mpmsg.size(); ++ind) {
+        payload.add(std::move(mpmsg[ind]));
+    }
+    mpmsg.clear();
+}
+
+const zio::multipart_t& zio::Message::payload() const
+{
+    static const zio::multipart_t empty;
+    return m_payload ? *m_payload : empty;
+}
+
+zio::multipart_t& zio::Message::parts()
+{
+    if (!m_payload) { m_payload = std::make_unique<multipart_t>(); }
+    return *m_payload;
+}
+
+void zio::Message::clear()
+{
+    auto& ph = m_header.prefix;
+    ph.level = level::undefined;
+    ph.form.assign(4, ' ');
+    ph.label.clear();
+    m_header.coord = CoordHeader{};
+    m_header.flow = FlowHeader{};
+    m_lobj = nullptr;
+    label_changed();
+    m_label_encoding = label_encoding_e::json;
+    clear_payload();
+    m_remid.clear();
+}
+
+zio::HeaderTemplate::HeaderTemplate(const PrefixHeader& prefix,
+                                    const CoordHeader& coord)
+    : m_prefix(prefix.dumps())
+    , m_coord(coord)
+{
+}
+
+zio::HeaderTemplate::HeaderTemplate(const Message& msg)
+    : HeaderTemplate(msg.prefix(), msg.coord())
+{
+    m_flow = msg.flow();
+}
+
+zio::multipart_t zio::HeaderTemplate::toparts(zio::multipart_t&& payload,
+                                              granule_t gran)
+{
+    if (gran == 0) { gran = zio::now_us().count(); }
+    m_coord.granule = gran;
+
+    // Headers go in front so the payload container is reused.
+    if (m_flow.empty()) { payload.pushtyp(m_coord); }
+    else {
+        payload.pushtyp(CoordFlow{m_coord, m_flow});
     }
+    payload.pushmem(m_prefix.data(), m_prefix.size());
+    ++m_coord.seqno;
+    return std::move(payload);
+}
+
+zio::MessagePool::MessagePool(size_t max_size) : m_max_size(max_size)
+{
+    m_idle.reserve(max_size);
+}
+
+zio::Message zio::MessagePool::acquire()
+{
+    if (m_idle.empty()) { return Message(); }
+    Message msg(std::move(m_idle.back()));
+    m_idle.pop_back();
+    return msg;
+}
+
+zio::Message zio::MessagePool::acquire(const std::string& form,
+                                       level::MessageLevel lvl)
+{
+    Message msg = acquire();
+    msg.set_form(form);
+    msg.set_level(lvl);
+    return msg;
+}
+
+void zio::MessagePool::release(Message&& msg)
+{
+    if (m_idle.size() >= m_max_size) { return; }
+    msg.clear();
+    m_idle.push_back(std::move(msg));
 }
@@ -1,7 +1,9 @@
 #include "zio/port.hpp"
 #include "zio/util.hpp"
+#include "zio/tens.hpp"
 #include "zio/logging.hpp"
 
+#include <cstring>
 #include <sstream>
 #include <algorithm>
 #include <string>
@@ -184,6 +186,7 @@ void zio::Port::online(zio::Peer& peer)
 void zio::Port::offline()
 {
     if (!m_online) return;
+    flush();
     m_online = false;
 
     for (const auto& addr : m_connected) { m_sock.disconnect(addr); }
@@ -201,15 +204,128 @@ void zio::Port::offline()
 //         stype == ZMQ_DISH;
 // }
 
+void zio::Port::set_compression(const std::string& codec, size_t threshold,
+                                size_t nthreads)
+{
+    m_codec = nullptr;
+    if (codec.empty()) { return; }
+    m_codec = codec::get(codec);
+    if (!m_codec) {
+        throw std::runtime_error("Port: unknown codec " + codec);
+    }
+    m_codec_threshold = threshold;
+    m_codec_nthreads = nthreads;
+}
+
+void zio::Port::compress(zio::multipart_t& mmsg)
+{
+    if (!m_codec) { return; }
+    codec::compress(mmsg, *m_codec, m_codec_threshold, m_codec_nthreads);
+}
+
+// The prefix of a message carrying a batch of encoded messages.  Its
+// level character is not a digit so no application message, which
+// always has a digit there, may be taken for a batch.
+static const char batch_prefix[] = "ZIO*BTCH";
+static const size_t batch_prefix_size = sizeof(batch_prefix) - 1;
+
+static bool is_batch(const zio::message_t& prefix)
+{
+    return prefix.size() == batch_prefix_size and
+           memcmp(prefix.data(), batch_prefix, batch_prefix_size) == 0;
+}
+
+void zio::Port::set_batching(size_t max_count, size_t max_bytes,
+                             std::chrono::milliseconds linger)
+{
+    flush();
+    m_batch_count = max_count < 2 ? 0 : max_count;
+    m_batch_bytes = max_bytes;
+    m_batch_linger = linger;
+}
+
+bool zio::Port::flush()
+{
+    if (m_batch.empty()) { return false; }
+
+    m_batch.pushtyp(CoordHeader{m_origin, 0, 0});
+    m_batch.push(zio::message_t(batch_prefix, batch_prefix_size));
+
+    const bool ok = send_parts(m_batch, m_batch_remid);
+    m_batch.clear();
+    m_batch_held_bytes = 0;
+    return ok;
+}
+
+bool zio::Port::send_batched(zio::message_t&& encoded,
+                             const remote_identity_t& remid)
+{
+    const auto now = std::chrono::steady_clock::now();
+    // A batch goes to one remote so one for another is sent first.
+    bool ok = true;
+    if (!m_batch.empty() and remid != m_batch_remid) { ok = flush(); }
+    if (m_batch.empty()) {
+        m_batch_remid = remid;
+        m_batch_start = now;
+    }
+    m_batch_held_bytes += encoded.size();
+    m_batch.add(std::move(encoded));
+
+    if (m_batch.size() >= m_batch_count or
+        m_batch_held_bytes >= m_batch_bytes or
+        now - m_batch_start >= m_batch_linger) {
+        const bool sent = flush();
+        return ok and sent;
+    }
+    return ok;
+}
+
 bool zio::Port::send(zio::Message& msg, timeout_t /*timeout*/)
 {
     // zio::debug("[port {}] send {} #{} {}",
     //            m_name, msg.form(), msg.seqno(),
     //            zio::binstr(msg.remote_id()));
     msg.set_coord(m_origin);
-    zio::multipart_t mmsg = msg.toparts();
+    if (m_label_encoding) { msg.set_label_encoding(*m_label_encoding); }
+    msg.toparts(m_send_parts);
+    return send_prepared(msg.remote_id());
+}
+
+bool zio::Port::send(zio::Message&& msg, timeout_t /*timeout*/)
+{
+    msg.set_coord(m_origin);
+    if (m_label_encoding) { msg.set_label_encoding(*m_label_encoding); }
+    const remote_identity_t remid = msg.remote_id();
+    std::move(msg).toparts(m_send_parts);
+    return send_prepared(remid);
+}
+
+bool zio::Port::send_prepared(const remote_identity_t& remid)
+{
+    compress(m_send_parts);
+    const bool ok = m_batch_count
+                        ? send_batched(m_send_parts.encode(), remid)
+                        : send_parts(m_send_parts, remid);
+    // Parts may reference external buffers which must not be held.
+    m_send_parts.clear();
+    return ok;
+}
+
+bool zio::Port::send(zio::HeaderTemplate& head, zio::multipart_t&& payload,
+                      const remote_identity_t& remid)
+{
+    if (m_origin) { head.coord().origin = m_origin; }
+    zio::multipart_t mmsg = head.toparts(std::move(payload));
+    compress(mmsg);
+    if (m_batch_count) { return send_batched(mmsg.encode(), remid); }
+    return send_parts(mmsg, remid);
+}
+
+bool zio::Port::send_parts(zio::multipart_t& mmsg,
+                           const remote_identity_t& remid)
+{
     if (zio::is_serverish(m_sock)) {
-        send_serverish(m_sock, mmsg, msg.remote_id());
+        send_serverish(m_sock, mmsg, remid);
         return true;
     }
     if (zio::is_clientish(m_sock)) {
@@ -220,28 +336,101 @@ bool zio::Port::send(zio::Message& msg, timeout_t /*timeout*/)
     throw std::runtime_error("Port::send: unsupported socket type");
 }
 
+bool zio::Port::recv_batched(Message& msg)
+{
+    m_recv_parts.clear();
+    decode_adopt(m_unbatched.pop(), m_recv_parts);
+    codec::decompress(m_recv_parts);
+    msg.fromparts(std::move(m_recv_parts));
+    msg.set_remote_id(m_unbatched_remid);
+    align(msg);
+    return true;
+}
+
+void zio::Port::align(Message& msg)
+{
+    if (!m_tensor_alignment) { return; }
+    // Avoid parsing labels which can not describe tensors.
+    if (msg.prefix().label.find(tens::form) == std::string::npos) { return; }
+    const size_t ncopied = tens::align(msg, m_tensor_alignment);
+    if (ncopied) {
+        zio::debug("[port {}] copied {} tensor parts to align them", m_name,
+                   ncopied);
+    }
+}
+
 bool zio::Port::recv(Message& msg, timeout_t timeout)
 {
+    if (!m_unbatched.empty()) { return recv_batched(msg); }
+
     long tout = -1;
     if (timeout.has_value()) { tout = timeout.value().count(); }
+
+    // Do not hold messages while possibly waiting for a reply.
+    if (!m_batch.empty() and
+        (tout != 0 or
+         std::chrono::steady_clock::now() - m_batch_start >= m_batch_linger)) {
+        flush();
+    }
     // zio::debug("[port {}] polling for {}", m_name, tout);
     zio::pollitem_t items[] = {{m_sock, 0, ZMQ_POLLIN, 0}};
     int item = zio::poll(&items[0], 1, tout);
     if (!item) return false;
 
+    return recv_now(msg, zio::recv_flags::none);
+}
+
+size_t zio::Port::recv_many(std::vector<Message>& msgs, size_t max,
+                            timeout_t timeout)
+{
+    size_t count = 0;
+    auto slot = [&]() -> Message& {
+        if (count == msgs.size()) { msgs.emplace_back(); }
+        return msgs[count];
+    };
+
+    if (!max or !recv(slot(), timeout)) { return 0; }
+    ++count;
+
+    // Take only what is already queued, without polling.
+    while (count < max) {
+        if (!m_unbatched.empty()) { recv_batched(slot()); }
+        else if (!recv_now(slot(), zio::recv_flags::dontwait)) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+bool zio::Port::recv_now(Message& msg, recv_flags flags)
+{
+    // The receive container is reused to avoid allocating per message.
+    m_recv_parts.clear();
+    remote_identity_t remid;
+    recv_result_t res;
     if (zio::is_serverish(m_sock)) {
-        zio::multipart_t mmsg;
-        remote_identity_t remid;
-        recv_serverish(m_sock, mmsg, remid);
-        msg.fromparts(mmsg);
-        msg.set_remote_id(remid);
-        return true;
+        res = recv_serverish(m_sock, m_recv_parts, remid, flags);
     }
-    if (zio::is_clientish(m_sock)) {
-        zio::multipart_t mmsg;
-        recv_clientish(m_sock, mmsg);
-        msg.fromparts(mmsg);
-        return true;
+    else if (zio::is_clientish(m_sock)) {
+        res = recv_clientish(m_sock, m_recv_parts, flags);
     }
-    throw std::runtime_error("Port::recv: unsupported socket type");
+    else {
+        throw std::runtime_error("Port::recv: unsupported socket type");
+    }
+    if (!res) { return false; }
+
+    if (m_recv_parts.size() > 2 and is_batch(m_recv_parts[0])) {
+        m_recv_parts.pop();  // prefix
+        m_recv_parts.pop();  // coord
+        while (!m_recv_parts.empty()) { m_unbatched.add(m_recv_parts.pop()); }
+        m_unbatched_remid = remid;
+        return recv_batched(msg);
+    }
+
+    codec::decompress(m_recv_parts);
+    msg.fromparts(std::move(m_recv_parts));
+    msg.set_remote_id(remid);
+    align(msg);
+    return true;
 }
@@ -1,7 +1,20 @@
 #include "zio/tens.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
 #include <complex>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
 #include <typeinfo>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define ZIO_TENS_F16C
+#endif
+
 namespace zio {
     namespace tens {
         const char* form = "TENS";
@@ -46,38 +59,1330 @@ const char* zio::tens::type_name(const std::type_info& t)
         return "?";
 }
 
+// Split a dtype into kind and size, the size defaulting to word.
+// Return false if malformed or of foreign byte order.
+static bool parse_dtype(const std::string& dtype, size_t word, char& kind,
+                        size_t& size)
+{
+    size_t pos = 0;
+    if (dtype.size() > 1 and strchr("<>|=", dtype[0])) {
+        const char native = zio::tens::dtype_traits<int>::order;
+        if (dtype[0] != '|' and dtype[0] != '=' and dtype[0] != native) {
+            return false;
+        }
+        ++pos;
+    }
+    if (pos >= dtype.size()) { return false; }
+    kind = dtype[pos++];
+    if (pos == dtype.size()) {
+        size = word;
+        return true;
+    }
+    size = 0;
+    for (; pos < dtype.size(); ++pos) {
+        if (!isdigit((unsigned char)dtype[pos])) { return false; }
+        size = 10 * size + (dtype[pos] - '0');
+    }
+    return true;
+}
+
+bool zio::tens::dtype_matches(const std::string& dtype, size_t word,
+                              const char* code, size_t code_word)
+{
+    if (word != code_word) { return false; }
+    char kind = 0, want_kind = 0;
+    size_t size = 0, want_size = 0;
+    return parse_dtype(dtype, word, kind, size) and
+           parse_dtype(code, code_word, want_kind, want_size) and
+           kind == want_kind and size == want_size and size == word;
+}
+
+void zio::tens::set_checksums(Message& msg, bool on)
+{
+    if (msg.form().empty()) { msg.set_form(zio::tens::form); }
+    auto& lobj = msg.label_object_ref();
+    if (!lobj.is_object()) { lobj = zio::json::value_t::object; }
+    lobj[zio::tens::form]["checksums"] = on;
+}
+
+bool zio::tens::checksums(const Message& msg)
+{
+    const auto& lobj = msg.label_object();
+    if (!lobj.is_object()) { return false; }
+    const auto ta = lobj.find(zio::tens::form);
+    if (ta == lobj.end() or !ta->is_object()) { return false; }
+    const auto jon = ta->find("checksums");
+    return jon != ta->end() and jon->is_boolean() and jon->get<bool>();
+}
+
+// Describe and add the data.  An empty order means C order.  If
+// checksums are on for the message, a crc not already computed is
+// computed here.
+// Return the description, which may be extended.
+static zio::json& add_tensor(zio::Message& msg, zio::message_t&& data,
+                             const std::vector<size_t>& shape,
+                             size_t word_size, const char* tn,
+                             const std::vector<size_t>& order,
+                             const zio::json& metadata,
+                             std::optional<uint32_t> crc = std::nullopt)
+{
+    if (msg.form().empty()) { msg.set_form(zio::tens::form); }
+    zio::json md = {{"shape", shape},
+                    {"word", word_size},
+                    {"dtype", tn},
+                    {"part", msg.payload().size()}};
+    if (!order.empty()) { md["order"] = order; }
+    if (!crc and zio::tens::checksums(msg)) {
+        crc = zio::crc32c(data.data(), data.size());
+    }
+    if (crc) { md["crc32c"] = *crc; }
+    if (!metadata.is_null()) { md["metadata"] = metadata; }
+    // Work on the cached label object so appending many tensors does
+    // not re-parse and re-serialize the label for each.
+    auto& lobj = msg.label_object_ref();
+    if (!lobj.is_object()) { lobj = zio::json::value_t::object; }
+    auto& tensors = lobj[zio::tens::form]["tensors"];
+    tensors.push_back(md);
+    msg.add(std::move(data));
+    return tensors.back();
+}
+
 void zio::tens::append(zio::Message& msg, zio::message_t&& data,
                        const std::vector<size_t>& shape, size_t word_size,
                        const char* tn, const zio::json& metadata)
 {
+    add_tensor(msg, std::move(data), shape, word_size, tn, {}, metadata);
+}
+
+void zio::tens::append_copy(zio::Message& msg, const void* data,
+                            size_t nbytes, const std::vector<size_t>& shape,
+                            size_t word_size, const char* tn,
+                            const zio::json& metadata)
+{
+    if (!checksums(msg)) {
+        add_tensor(msg, zio::message_t(data, nbytes), shape, word_size, tn,
+                   {}, metadata);
+        return;
+    }
+    zio::message_t part(nbytes);
+    const uint32_t crc = crc32c_copy(part.data(), data, nbytes);
+    add_tensor(msg, std::move(part), shape, word_size, tn, {}, metadata, crc);
+}
+
+// True if strides are those of the order, ignoring unit dimensions.
+static bool has_strides(const std::vector<size_t>& shape,
+                        const std::vector<size_t>& strides,
+                        const std::vector<size_t>& order)
+{
+    const auto want = zio::tens::order_strides(shape, order);
+    for (size_t dim = 0; dim < shape.size(); ++dim) {
+        if (shape[dim] > 1 and strides[dim] != want[dim]) { return false; }
+    }
+    return true;
+}
+
+template <typename Word>
+static void gather_row(const char* src, char* dst, size_t num, size_t stride)
+{
+    const Word* from = (const Word*)src;
+    Word* to = (Word*)dst;
+    for (size_t ind = 0; ind < num; ++ind) { to[ind] = from[ind * stride]; }
+}
+
+template <size_t Size>
+struct Bytes
+{
+    char bytes[Size];
+};
+
+// Copy elements of any layout to dst in C order in one pass.
+static void gather(const char* src, char* dst, const std::vector<size_t>& shape,
+                   const std::vector<size_t>& strides, size_t word)
+{
+    const size_t rank = shape.size();
+    if (!rank) {
+        memcpy(dst, src, word);
+        return;
+    }
+    for (auto s : shape) {
+        if (!s) { return; }
+    }
+    const size_t inner = shape[rank - 1], istride = strides[rank - 1];
+    std::vector<size_t> index(rank - 1, 0);
+    while (true) {
+        size_t off = 0;
+        for (size_t dim = 0; dim + 1 < rank; ++dim) {
+            off += index[dim] * strides[dim];
+        }
+        const char* row = src + off * word;
+        if (istride == 1) { memcpy(dst, row, inner * word); }
+        else {
+            switch (word) {
+                case 1: gather_row<uint8_t>(row, dst, inner, istride); break;
+                case 2: gather_row<uint16_t>(row, dst, inner, istride); break;
+                case 4: gather_row<uint32_t>(row, dst, inner, istride); break;
+                case 8: gather_row<uint64_t>(row, dst, inner, istride); break;
+                case 16: gather_row<Bytes<16>>(row, dst, inner, istride); break;
+                default:
+                    for (size_t ind = 0; ind < inner; ++ind) {
+                        memcpy(dst + ind * word, row + ind * istride * word,
+                               word);
+                    }
+            }
+        }
+        dst += inner * word;
+
+        // C order odometer over all but the inner dimension
+        size_t dim = rank - 1;
+        for (; dim > 0; --dim) {
+            if (++index[dim - 1] < shape[dim - 1]) { break; }
+            index[dim - 1] = 0;
+        }
+        if (!dim) { return; }
+    }
+}
+
+void zio::tens::append_strided(zio::Message& msg, const void* data,
+                               const std::vector<size_t>& shape,
+                               const std::vector<size_t>& strides,
+                               size_t word_size, const char* tn,
+                               const zio::json& md)
+{
+    const size_t rank = shape.size();
+    if (strides.size() != rank) {
+        throw std::runtime_error("tens: strides do not match shape");
+    }
+    size_t nbytes = word_size;
+    for (auto s : shape) { nbytes *= s; }
+
+    std::vector<size_t> corder(rank), forder(rank);
+    for (size_t dim = 0; dim < rank; ++dim) {
+        corder[dim] = rank - 1 - dim;
+        forder[dim] = dim;
+    }
+    if (has_strides(shape, strides, corder)) {
+        add_tensor(msg, zio::message_t(data, nbytes), shape, word_size, tn, {},
+                   md);
+        return;
+    }
+    if (has_strides(shape, strides, forder)) {
+        add_tensor(msg, zio::message_t(data, nbytes), shape, word_size, tn,
+                   forder, md);
+        return;
+    }
+    zio::message_t part(nbytes);
+    gather((const char*)data, part.data<char>(), shape, strides, word_size);
+    add_tensor(msg, std::move(part), shape, word_size, tn, {}, md);
+}
+
+void zio::tens::append_sparse(zio::Message& msg, const std::string& packing,
+                              zio::message_t&& values, zio::message_t&& indices,
+                              zio::message_t&& indptr, size_t nnz,
+                              const std::vector<size_t>& shape,
+                              size_t word_size, const char* tn,
+                              size_t index_word, const zio::json& metadata)
+{
+    size_t nind = nnz * shape.size();
+    if (packing == "csr") {
+        if (shape.size() != 2) {
+            throw std::runtime_error("tens: csr requires rank 2");
+        }
+        nind = nnz;
+        if (indptr.size() != (shape[0] + 1) * index_word) {
+            throw std::runtime_error("tens: bad csr indptr size");
+        }
+    }
+    else if (packing != "coo") {
+        throw std::runtime_error("tens: unknown packing " + packing);
+    }
+    if (values.size() != nnz * word_size or
+        indices.size() != nind * index_word) {
+        throw std::runtime_error("tens: bad sparse size");
+    }
+
     if (msg.form().empty()) { msg.set_form(zio::tens::form); }
-    zio::json lobj = zio::json::value_t::object;
-    std::string label = msg.label();
-    if (!label.empty()) { lobj = zio::json::parse(label); }
+    const size_t part = msg.payload().size();
+    zio::json md = {{"shape", shape},       {"word", word_size},
+                    {"dtype", tn},          {"part", part},
+                    {"packing", packing},   {"nnz", nnz},
+                    {"indices", part + 1},  {"index_word", index_word}};
+    if (packing == "csr") { md["indptr"] = part + 2; }
+    if (!metadata.is_null()) { md["metadata"] = metadata; }
+    auto& lobj = msg.label_object_ref();
+    if (!lobj.is_object()) { lobj = zio::json::value_t::object; }
+    lobj[zio::tens::form]["tensors"].push_back(md);
+    msg.add(std::move(values));
+    msg.add(std::move(indices));
+    if (packing == "csr") { msg.add(std::move(indptr)); }
+}
+
+void zio::tens::append_chunk(zio::Message& msg, zio::message_t&& data,
+                             const std::vector<size_t>& full_shape,
+                             size_t offset, size_t nrows, size_t word_size,
+                             const char* tn, const std::string& id,
+                             const zio::json& metadata)
+{
+    if (full_shape.empty() or offset > full_shape[0] or
+        nrows > full_shape[0] - offset) {
+        throw std::runtime_error("tens: chunk outside of tensor");
+    }
+    if (msg.form().empty()) { msg.set_form(zio::tens::form); }
+    auto shape = full_shape;
+    shape[0] = nrows;
     zio::json md = {
         {"shape", shape},
         {"word", word_size},
         {"dtype", tn},
-        {"part", msg.payload().size()}
-        // no order as this is C++
-    };
+        {"part", msg.payload().size()},
+        {"chunk", {{"id", id}, {"offset", offset}, {"total", full_shape[0]}}}};
+    if (checksums(msg)) { md["crc32c"] = crc32c(data.data(), data.size()); }
     if (!metadata.is_null()) { md["metadata"] = metadata; }
+    auto& lobj = msg.label_object_ref();
+    if (!lobj.is_object()) { lobj = zio::json::value_t::object; }
     lobj[zio::tens::form]["tensors"].push_back(md);
-    msg.set_label_object(lobj);
     msg.add(std::move(data));
 }
 
+namespace {
+
+    constexpr auto half_code =
+        zio::tens::dtype_code(zio::tens::dtype_traits<uint16_t>::order, 'f', 2);
+
+    // Portable conversions, after F. Giesen's float_to_half_fast3_rtne.
+    uint16_t to_half(float val)
+    {
+        uint32_t bits;
+        memcpy(&bits, &val, 4);
+        const uint16_t sign = (bits >> 16) & 0x8000;
+        bits &= 0x7fffffff;
+        if (bits >= 0x47800000) {  // overflow, inf or nan
+            return sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00);
+        }
+        if (bits < 0x38800000) {  // subnormal or zero
+            float sub;
+            memcpy(&sub, &bits, 4);
+            sub += 0.5f;  // its unit in last place is the half's
+            memcpy(&bits, &sub, 4);
+            return sign | (uint16_t)(bits - 0x3f000000);
+        }
+        const uint32_t odd = (bits >> 13) & 1;
+        bits += 0xc8000fff + odd;  // rebias and round to nearest even
+        return sign | (uint16_t)(bits >> 13);
+    }
+
+    float from_half(uint16_t half)
+    {
+        const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+        const uint32_t rest = half & 0x7fff;
+        uint32_t bits;
+        if (rest >= 0x7c00) {  // inf or nan
+            bits = 0x7f800000 | ((rest & 0x3ff) << 13);
+        }
+        else if (rest >= 0x0400) {  // normal
+            bits = (rest << 13) + 0x38000000;
+        }
+        else {  // subnormal
+            const float sub = rest * 5.9604644775390625e-8f;  // 2^-24
+            memcpy(&bits, &sub, 4);
+        }
+        bits |= sign;
+        float val;
+        memcpy(&val, &bits, 4);
+        return val;
+    }
+
+#ifdef ZIO_TENS_F16C
+    bool have_f16c()
+    {
+        static const bool have =
+            __builtin_cpu_supports("f16c") and __builtin_cpu_supports("avx");
+        return have;
+    }
+
+    __attribute__((target("avx,f16c"))) size_t
+    float_to_half_f16c(const float* in, uint16_t* out, size_t n)
+    {
+        size_t ind = 0;
+        for (; ind + 8 <= n; ind += 8) {
+            const __m256 val = _mm256_loadu_ps(in + ind);
+            const __m128i half = _mm256_cvtps_ph(val, _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128((__m128i*)(out + ind), half);
+        }
+        return ind;
+    }
+
+    __attribute__((target("avx,f16c"))) size_t
+    half_to_float_f16c(const uint16_t* in, float* out, size_t n)
+    {
+        size_t ind = 0;
+        for (; ind + 8 <= n; ind += 8) {
+            const __m128i half = _mm_loadu_si128((const __m128i*)(in + ind));
+            _mm256_storeu_ps(out + ind, _mm256_cvtph_ps(half));
+        }
+        return ind;
+    }
+#endif
+
+    const char* quant_name(zio::tens::quant_e codec)
+    {
+        switch (codec) {
+            case zio::tens::quant_e::f16: return "f16";
+            case zio::tens::quant_e::bf16: return "bf16";
+            case zio::tens::quant_e::i16: return "i16";
+        }
+        return "";
+    }
+}  // namespace
+
+void zio::tens::float_to_half(const float* in, uint16_t* out, size_t n)
+{
+    size_t ind = 0;
+#ifdef ZIO_TENS_F16C
+    if (have_f16c()) { ind = float_to_half_f16c(in, out, n); }
+#endif
+    for (; ind < n; ++ind) { out[ind] = to_half(in[ind]); }
+}
+
+void zio::tens::half_to_float(const uint16_t* in, float* out, size_t n)
+{
+    size_t ind = 0;
+#ifdef ZIO_TENS_F16C
+    if (have_f16c()) { ind = half_to_float_f16c(in, out, n); }
+#endif
+    for (; ind < n; ++ind) { out[ind] = from_half(in[ind]); }
+}
+
+// The bfloat16 loops are simple enough for the compiler to vectorize.
+void zio::tens::float_to_bfloat(const float* in, uint16_t* out, size_t n)
+{
+    for (size_t ind = 0; ind < n; ++ind) {
+        uint32_t bits;
+        memcpy(&bits, in + ind, 4);
+        const bool nan = (bits & 0x7fffffff) > 0x7f800000;
+        const uint32_t round = 0x7fff + ((bits >> 16) & 1);
+        out[ind] = nan ? (uint16_t)((bits >> 16) | 0x40)
+                       : (uint16_t)((bits + round) >> 16);
+    }
+}
+
+void zio::tens::bfloat_to_float(const uint16_t* in, float* out, size_t n)
+{
+    for (size_t ind = 0; ind < n; ++ind) {
+        const uint32_t bits = (uint32_t)in[ind] << 16;
+        memcpy(out + ind, &bits, 4);
+    }
+}
+
+void zio::tens::append_quantized(zio::Message& msg, const float* data,
+                                 const std::vector<size_t>& shape,
+                                 const Quantization& quant,
+                                 const zio::json& metadata)
+{
+    size_t size = 1;
+    for (auto s : shape) { size *= s; }
+    zio::message_t part(size * 2);
+    const char* code = dtype<uint16_t>();
+    float scale = quant.scale, offset = quant.offset;
+
+    switch (quant.codec) {
+        case quant_e::f16:
+            code = half_code.data();
+            float_to_half(data, part.data<uint16_t>(), size);
+            break;
+        case quant_e::bf16:
+            float_to_bfloat(data, part.data<uint16_t>(), size);
+            break;
+        case quant_e::i16: {
+            code = dtype<int16_t>();
+            if (scale == 0 and size) {
+                // Span the finite values, in double so the range of
+                // extreme floats does not overflow.
+                double lo = HUGE_VAL, hi = -HUGE_VAL;
+                for (size_t ind = 0; ind < size; ++ind) {
+                    if (!std::isfinite(data[ind])) { continue; }
+                    lo = std::min(lo, (double)data[ind]);
+                    hi = std::max(hi, (double)data[ind]);
+                }
+                if (lo <= hi) {
+                    offset = 0.5 * (lo + hi);
+                    scale = (hi - lo) / 65534.0;
+                }
+                if (!(scale > 0) or !std::isfinite(1.0f / scale)) {
+                    scale = 1;
+                }
+            }
+            const float inv = 1.0f / scale;
+            int16_t* out = part.data<int16_t>();
+            for (size_t ind = 0; ind < size; ++ind) {
+                float val = (data[ind] - offset) * inv;
+                // NaN is stored as zero, ie decodes to the offset, and
+                // infinities saturate.
+                if (std::isnan(val)) { val = 0; }
+                val = std::min(std::max(val, -32767.0f), 32767.0f);
+                out[ind] = (int16_t)(val + (val < 0 ? -0.5f : 0.5f));
+            }
+            break;
+        }
+    }
+
+    auto& md = add_tensor(msg, std::move(part), shape, 2, code, {}, metadata);
+    md["quant"] = {{"codec", quant_name(quant.codec)},
+                   {"dtype", dtype<float>()}};
+    if (quant.codec == quant_e::i16) {
+        md["quant"]["scale"] = scale;
+        md["quant"]["offset"] = offset;
+    }
+}
+
+bool zio::tens::dequantize(const TensorRef& ref, float* out)
+{
+    if (!ref or !ref.quantized() or ref.word != 2) { return false; }
+    const size_t size = ref.size();
+    if (ref.quant == "f16") {
+        half_to_float((const uint16_t*)ref.data, out, size);
+    }
+    else if (ref.quant == "bf16") {
+        bfloat_to_float((const uint16_t*)ref.data, out, size);
+    }
+    else if (ref.quant == "i16") {
+        const int16_t* in = (const int16_t*)ref.data;
+        for (size_t ind = 0; ind < size; ++ind) {
+            out[ind] = in[ind] * ref.quant_scale + ref.quant_offset;
+        }
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<float> zio::tens::Reader::dequantize(size_t index) const
+{
+    std::vector<float> ret;
+    if (index >= m_refs.size() or !m_refs[index] or
+        !m_refs[index].quantized()) {
+        return ret;
+    }
+    ret.resize(m_refs[index].size());
+    if (!zio::tens::dequantize(m_refs[index], ret.data())) { ret.clear(); }
+    return ret;
+}
+
+// The binary descriptor part holds a header followed by one record per
+// tensor.  All integers are little endian.
+//
+//   header: "TDSC" u16(version) u16(0) u32(count)
+//   record: u8(rank) u8(flags) u8(dtype size) u8(0) u32(word) u32(part)
+//           dtype chars, rank x u64(shape), [u64(offset)], [u32(crc32c)]
+//
+// The crc32c is present if flags has desc_crc set.  The byte offset of
+// the data in its part is present if flags has desc_packed set, in
+// which case the part may hold other tensors.
+namespace {
+    const char desc_magic[4] = {'T', 'D', 'S', 'C'};
+    const uint16_t desc_version = 1;
+    const size_t desc_header_size = 12;
+    // Size of a record of a scalar with an empty dtype.
+    const size_t desc_record_min = 12;
+    const uint8_t desc_crc = 0x01;
+    const uint8_t desc_packed = 0x02;
+
+    template <typename Int>
+    void put_int(std::string& buf, Int val)
+    {
+        for (size_t ind = 0; ind < sizeof(Int); ++ind) {
+            buf.push_back((char)((val >> (8 * ind)) & 0xff));
+        }
+    }
+    template <typename Int>
+    void put_int_at(std::string& buf, size_t pos, Int val)
+    {
+        for (size_t ind = 0; ind < sizeof(Int); ++ind) {
+            buf[pos + ind] = (char)((val >> (8 * ind)) & 0xff);
+        }
+    }
+
+    // Sequential reading of a descriptor with bounds checking.
+    struct DescReader
+    {
+        const uint8_t* ptr;
+        const uint8_t* end;
+
+        bool has(size_t n) const { return (size_t)(end - ptr) >= n; }
+
+        template <typename Int>
+        Int get()
+        {
+            if (!has(sizeof(Int))) { throw std::out_of_range("descriptor"); }
+            Int val = 0;
+            for (size_t ind = 0; ind < sizeof(Int); ++ind) {
+                val |= (Int)ptr[ind] << (8 * ind);
+            }
+            ptr += sizeof(Int);
+            return val;
+        }
+        std::string get_str(size_t n)
+        {
+            if (!has(n)) { throw std::out_of_range("descriptor"); }
+            std::string ret((const char*)ptr, n);
+            ptr += n;
+            return ret;
+        }
+    };
+
+    void append_record(std::string& buf, const std::vector<size_t>& shape,
+                       size_t word, const std::string& dtype, size_t part,
+                       bool has_crc, uint32_t crc, bool packed = false,
+                       size_t offset = 0)
+    {
+        if (shape.size() > 255 or dtype.size() > 255) {
+            throw std::runtime_error("tens: can not describe tensor");
+        }
+        put_int<uint8_t>(buf, shape.size());
+        put_int<uint8_t>(buf, (has_crc ? desc_crc : 0) |
+                                  (packed ? desc_packed : 0));
+        put_int<uint8_t>(buf, dtype.size());
+        put_int<uint8_t>(buf, 0);
+        put_int<uint32_t>(buf, word);
+        put_int<uint32_t>(buf, part);
+        buf += dtype;
+        for (auto s : shape) { put_int<uint64_t>(buf, s); }
+        if (packed) { put_int<uint64_t>(buf, offset); }
+        if (has_crc) { put_int<uint32_t>(buf, crc); }
+    }
+
+    // Fill refs from descriptor, and which are packed, return false if
+    // malformed.
+    bool load_records(const zio::message_t& desc,
+                      std::vector<zio::tens::TensorRef>& refs,
+                      std::vector<bool>& packed)
+    {
+        DescReader dr{desc.data<uint8_t>(), desc.data<uint8_t>() + desc.size()};
+        try {
+            if (dr.get_str(4) != std::string(desc_magic, 4)) { return false; }
+            if (dr.get<uint16_t>() != desc_version) { return false; }
+            dr.get<uint16_t>();
+            const size_t count = dr.get<uint32_t>();
+            // Do not let a corrupt count make us allocate.
+            if (count > (size_t)(dr.end - dr.ptr) / desc_record_min) {
+                return false;
+            }
+            refs.resize(count);
+            packed.assign(count, false);
+            for (size_t index = 0; index < count; ++index) {
+                auto& ref = refs[index];
+                const size_t rank = dr.get<uint8_t>();
+                const uint8_t flags = dr.get<uint8_t>();
+                const size_t ndtype = dr.get<uint8_t>();
+                dr.get<uint8_t>();
+                ref.word = dr.get<uint32_t>();
+                ref.part = dr.get<uint32_t>();
+                ref.dtype = dr.get_str(ndtype);
+                ref.shape.resize(rank);
+                for (auto& s : ref.shape) { s = dr.get<uint64_t>(); }
+                if (flags & desc_packed) {
+                    packed[index] = true;
+                    ref.part_offset = dr.get<uint64_t>();
+                }
+                if (flags & desc_crc) {
+                    ref.has_checksum = true;
+                    ref.checksum = dr.get<uint32_t>();
+                }
+            }
+        }
+        catch (const std::out_of_range& err) {
+            return false;
+        }
+        return true;
+    }
+}  // namespace
+
+// Return the TENS object of the label or nullptr.
+static const zio::json* tens_object(const zio::Message& msg)
+{
+    const auto& lobj = msg.label_object();
+    if (!lobj.is_object()) { return nullptr; }
+    const auto ta = lobj.find(zio::tens::form);
+    if (ta == lobj.end() or !ta->is_object()) { return nullptr; }
+    return &*ta;
+}
+
+// Return the binary descriptor part index of the label or -1.
+static int descriptor_part(const zio::Message& msg)
+{
+    const auto* ta = tens_object(msg);
+    if (!ta) { return -1; }
+    const auto jdesc = ta->find("descriptor");
+    if (jdesc == ta->end() or !jdesc->is_number()) { return -1; }
+    return jdesc->get<int>();
+}
+
+// Return the TENS tensors array of the label or nullptr.
+static const zio::json* tensors_array(const zio::Message& msg)
+{
+    const auto& lobj = msg.label_object();
+    if (!lobj.is_object()) { return nullptr; }
+    const auto ta = lobj.find(zio::tens::form);
+    if (ta == lobj.end()) { return nullptr; }
+    const auto tensors = ta->find("tensors");
+    if (tensors == ta->end() or !tensors->is_array()) { return nullptr; }
+    return &*tensors;
+}
+
+// Return the payload part index of a tensor description.
+static size_t part_index(const zio::json& md, size_t index)
+{
+    const auto jpart = md.find("part");
+    if (jpart != md.end() and jpart->is_number()) {
+        return jpart->get<size_t>();
+    }
+    return index;
+}
+
+// The part owned by a descriptor tensor or nullptr if it is
+// unresolved, corrupt or shares a packed part with other tensors.
+static const zio::message_t* own_part(const zio::Message& msg,
+                                      const zio::tens::TensorRef& ref)
+{
+    if (!ref or !ref.verify()) { return nullptr; }
+    const auto& part = msg.payload()[ref.part];
+    if (ref.data != part.data() or ref.nbytes != part.size()) {
+        return nullptr;
+    }
+    return &part;
+}
+
 const zio::message_t& zio::tens::at(const Message& msg, size_t index)
 {
     static const zio::message_t bogus;
 
-    auto lobj = msg.label_object();
-    auto ta = lobj[zio::tens::form];
-    auto md = ta["tensors"][index];
+    if (descriptor_part(msg) >= 0) {
+        Reader reader(msg);
+        if (index >= reader.size()) { return bogus; }
+        const auto* part = own_part(msg, reader.ref(index));
+        return part ? *part : bogus;
+    }
+
+    const auto* tensors = tensors_array(msg);
+    if (!tensors or index >= tensors->size()) { return bogus; }
+    const auto& md = (*tensors)[index];
+
+    if (!md.is_object()) { return bogus; }
+    size_t part = part_index(md, index);
+    if (part >= msg.payload().size()) { return bogus; }
+    const auto& data = msg.payload()[part];
+    const auto jcrc = md.find("crc32c");
+    if (jcrc != md.end() and
+        (!jcrc->is_number_unsigned() or
+         jcrc->get<uint32_t>() != crc32c(data.data(), data.size()))) {
+        return bogus;
+    }
+    return data;
+}
+
+const zio::message_t& zio::tens::at(const Message& msg, size_t index,
+                                    const std::string& dtype, size_t word)
+{
+    static const zio::message_t bogus;
+
+    if (descriptor_part(msg) >= 0) {
+        Reader reader(msg);
+        if (index >= reader.size()) { return bogus; }
+        const auto& ref = reader.ref(index);
+        if (!dtype_matches(ref.dtype, ref.word, dtype.c_str(), word)) {
+            return bogus;
+        }
+        const auto* part = own_part(msg, ref);
+        return part ? *part : bogus;
+    }
+
+    const auto& ret = at(msg, index);
+    if (ret.empty()) { return bogus; }
+    const auto& md = (*tensors_array(msg))[index];
+    if (!dtype_matches(md.value("dtype", ""), md.value("word", 0UL),
+                       dtype.c_str(), word)) {
+        return bogus;
+    }
+    return ret;
+}
+
+const void* zio::tens::at_data(const Message& msg, size_t index,
+                               const std::string& dtype, size_t word)
+{
+    if (descriptor_part(msg) < 0) {
+        const auto& part = at(msg, index, dtype, word);
+        return part.empty() ? nullptr : part.data();
+    }
+    Reader reader(msg);
+    if (index >= reader.size()) { return nullptr; }
+    const auto& ref = reader.ref(index);
+    if (!ref or !ref.nbytes or !ref.verify() or
+        !dtype_matches(ref.dtype, ref.word, dtype.c_str(), word)) {
+        return nullptr;
+    }
+    return ref.data;
+}
+
+bool zio::tens::TensorRef::verify() const
+{
+    if (!has_checksum) { return true; }
+    return data and crc32c(data, nbytes) == checksum;
+}
+
+size_t zio::tens::TensorRef::size() const
+{
+    size_t n = 1;
+    for (auto s : shape) { n *= s; }
+    return n;
+}
+
+std::vector<size_t> zio::tens::order_strides(const std::vector<size_t>& shape,
+                                             const std::vector<size_t>& order)
+{
+    const size_t rank = shape.size();
+    if (order.size() != rank) { return {}; }
+    std::vector<size_t> strides(rank, 0);
+    std::vector<bool> seen(rank, false);
+    size_t stride = 1;
+    for (size_t dim : order) {
+        if (dim >= rank or seen[dim]) { return {}; }
+        seen[dim] = true;
+        strides[dim] = stride;
+        stride *= shape[dim];
+    }
+    return strides;
+}
+
+std::vector<size_t> zio::tens::c_strides(const std::vector<size_t>& shape)
+{
+    std::vector<size_t> strides(shape.size(), 1);
+    for (size_t dim = shape.size(); dim > 1; --dim) {
+        strides[dim - 2] = strides[dim - 1] * shape[dim - 1];
+    }
+    return strides;
+}
+
+// Return the sparse index part of given size or nullptr.
+static const void* index_data(const zio::multipart_t& payload, size_t part,
+                              size_t nbytes)
+{
+    if (part >= payload.size()) { return nullptr; }
+    const auto& data = payload[part];
+    if (data.size() != nbytes) { return nullptr; }
+    return data.data();
+}
+
+// Return one unsigned index from an array of them.
+static size_t index_value(const void* data, size_t index_word, size_t index)
+{
+    switch (index_word) {
+        case 1: return ((const uint8_t*)data)[index];
+        case 2: return ((const uint16_t*)data)[index];
+        case 4: return ((const uint32_t*)data)[index];
+        case 8: return ((const uint64_t*)data)[index];
+    }
+    return 0;
+}
+
+// Multiply prod by factor, return false if it would overflow.
+static bool checked_mul(size_t& prod, size_t factor)
+{
+    if (factor and prod > std::numeric_limits<size_t>::max() / factor) {
+        return false;
+    }
+    prod *= factor;
+    return true;
+}
+
+// True if neither the number of elements of the shape nor, when some
+// dimension is zero, any of its strides overflow.
+static bool shape_fits(const std::vector<size_t>& shape)
+{
+    size_t n = 1;
+    for (auto s : shape) {
+        if (s and !checked_mul(n, s)) { return false; }
+    }
+    return true;
+}
+
+// Resolve data of a described tensor, leaving it null on mismatch.
+// Sparse tensors also give the parts holding their indices.
+static void resolve(zio::tens::TensorRef& ref, const zio::multipart_t& payload,
+                    size_t indices_part = 0, size_t indptr_part = 0)
+{
+    if (ref.part >= payload.size()) { return; }
+    if (!shape_fits(ref.shape)) { return; }
+    const auto& data = payload[ref.part];
+    size_t nbytes = ref.sparse() ? ref.nnz : ref.size();
+    if (!checked_mul(nbytes, ref.word) or data.size() != nbytes) { return; }
+    if (ref.sparse()) {
+        const size_t iw = ref.index_word;
+        if (iw != 1 and iw != 2 and iw != 4 and iw != 8) { return; }
+        if (ref.packing == "coo") {
+            size_t nind = ref.nnz;
+            if (!checked_mul(nind, ref.shape.size()) or
+                !checked_mul(nind, iw)) {
+                return;
+            }
+            ref.indices = index_data(payload, indices_part, nind);
+            if (!ref.indices) { return; }
+        }
+        else if (ref.packing == "csr") {
+            if (ref.shape.size() != 2) { return; }
+            size_t nind = ref.nnz, nptr = ref.shape[0];
+            if (!checked_mul(nind, iw) or
+                nptr == std::numeric_limits<size_t>::max() or
+                !checked_mul(++nptr, iw)) {
+                return;
+            }
+            ref.indices = index_data(payload, indices_part, nind);
+            ref.indptr = index_data(payload, indptr_part, nptr);
+            if (!ref.indices or !ref.indptr) { return; }
+            // The last row offset must bound the values.
+            if (index_value(ref.indptr, iw, ref.shape[0]) != ref.nnz) {
+                return;
+            }
+        }
+        else {
+            return;
+        }
+    }
+    ref.nbytes = data.size();
+    ref.data = data.data();
+}
+
+// Resolve data of a tensor packed with others into one part.
+static void resolve_packed(zio::tens::TensorRef& ref,
+                           const zio::multipart_t& payload)
+{
+    if (ref.part >= payload.size()) { return; }
+    if (!shape_fits(ref.shape)) { return; }
+    const auto& data = payload[ref.part];
+    size_t nbytes = ref.size();
+    if (!checked_mul(nbytes, ref.word)) { return; }
+    if (ref.part_offset > data.size() or
+        nbytes > data.size() - ref.part_offset) {
+        return;
+    }
+    ref.nbytes = nbytes;
+    ref.data = data.data<char>() + ref.part_offset;
+}
+
+zio::tens::Reader::Reader(const Message& msg)
+{
+    const auto& payload = msg.payload();
+
+    const int dpart = descriptor_part(msg);
+    if (dpart >= 0) {
+        std::vector<bool> packed;
+        if ((size_t)dpart >= payload.size() or
+            !load_records(payload[dpart], m_refs, packed)) {
+            m_refs.clear();
+            return;
+        }
+        for (size_t index = 0; index < m_refs.size(); ++index) {
+            auto& ref = m_refs[index];
+            ref.strides = c_strides(ref.shape);
+            if (packed[index]) { resolve_packed(ref, payload); }
+            else {
+                resolve(ref, payload);
+            }
+        }
+        return;
+    }
+
+    const auto* tensors = tensors_array(msg);
+    if (!tensors) { return; }
+
+    m_refs.resize(tensors->size());
+    for (size_t index = 0; index < tensors->size(); ++index) {
+        const auto& md = (*tensors)[index];
+        auto& ref = m_refs[index];
+        if (!md.is_object()) { continue; }
+        try {
+            ref.dtype = md.at("dtype").get<std::string>();
+            ref.word = md.at("word").get<size_t>();
+            ref.shape = md.at("shape").get<std::vector<size_t>>();
+        }
+        catch (const zio::json::exception& err) {
+            continue;  // leave unresolved
+        }
+        ref.strides = c_strides(ref.shape);
+        const auto jorder = md.find("order");
+        if (jorder != md.end()) {
+            try {
+                ref.strides = order_strides(
+                    ref.shape, jorder->get<std::vector<size_t>>());
+            }
+            catch (const zio::json::exception& err) {
+                ref.strides.clear();
+            }
+            if (ref.strides.empty()) { continue; }  // leave unresolved
+        }
+        ref.part = part_index(md, index);
+        const auto jmd = md.find("metadata");
+        if (jmd != md.end()) { ref.metadata = *jmd; }
+        size_t indices_part = 0, indptr_part = 0;
+        const auto jpack = md.find("packing");
+        if (jpack != md.end() and *jpack != "dense") {
+            try {
+                ref.packing = jpack->get<std::string>();
+                ref.nnz = md.at("nnz").get<size_t>();
+                ref.index_word = md.at("index_word").get<size_t>();
+                indices_part = md.at("indices").get<size_t>();
+                indptr_part = md.value("indptr", 0UL);
+            }
+            catch (const zio::json::exception& err) {
+                continue;  // leave unresolved
+            }
+        }
+        const auto jcrc = md.find("crc32c");
+        if (jcrc != md.end() and jcrc->is_number_unsigned()) {
+            ref.has_checksum = true;
+            ref.checksum = jcrc->get<uint32_t>();
+        }
+        const auto jquant = md.find("quant");
+        if (jquant != md.end()) {
+            try {
+                ref.quant = jquant->at("codec").get<std::string>();
+                ref.quant_scale = jquant->value("scale", 1.0f);
+                ref.quant_offset = jquant->value("offset", 0.0f);
+            }
+            catch (const zio::json::exception& err) {
+                ref.quant.clear();
+                continue;  // leave unresolved
+            }
+        }
+        const auto jchunk = md.find("chunk");
+        if (jchunk != md.end()) {
+            try {
+                ref.chunk = jchunk->at("id").get<std::string>();
+                ref.offset = jchunk->at("offset").get<size_t>();
+                ref.total = jchunk->at("total").get<size_t>();
+            }
+            catch (const zio::json::exception& err) {
+                ref.chunk.clear();
+                continue;  // leave unresolved
+            }
+        }
+        resolve(ref, payload, indices_part, indptr_part);
+    }
+}
+
+static void release_pack(void* data, void* /*hint*/) { std::free(data); }
+
+zio::tens::Builder::Builder(Message& msg)
+    : m_msg(msg)
+    , m_checksums(checksums(msg))
+{
+    if (tensors_array(msg)) {
+        throw std::runtime_error("tens: builder given JSON tensors");
+    }
+    m_desc.assign(desc_magic, 4);
+    put_int<uint16_t>(m_desc, desc_version);
+    put_int<uint16_t>(m_desc, 0);
+    put_int<uint32_t>(m_desc, 0);  // count, set by finish()
+}
+
+zio::tens::Builder::Builder(Message& msg, size_t reserve, size_t alignment)
+    : Builder(msg)
+{
+    if (!alignment or (alignment & (alignment - 1)) != 0) {
+        throw std::runtime_error("tens: alignment must be a power of two");
+    }
+    m_alignment = std::max(alignment, sizeof(void*));
+    m_part = msg.payload().size();
+    this->reserve(reserve);
+}
+
+zio::tens::Builder::~Builder() { std::free(m_pack); }
+
+void zio::tens::Builder::reserve(size_t nbytes)
+{
+    if (nbytes <= m_reserved) { return; }
+    nbytes = std::max(nbytes, 2 * m_reserved);
+    // aligned_alloc() requires a multiple of the alignment.
+    nbytes = (nbytes + m_alignment - 1) & ~(m_alignment - 1);
+    char* pack = (char*)std::aligned_alloc(m_alignment, nbytes);
+    if (!pack) { throw std::bad_alloc(); }
+    if (m_used) { memcpy(pack, m_pack, m_used); }
+    std::free(m_pack);
+    m_pack = pack;
+    m_reserved = nbytes;
+}
+
+void zio::tens::Builder::pack(const void* data, size_t nbytes,
+                              const std::vector<size_t>& shape, size_t word,
+                              const std::string& dtype)
+{
+    if (m_finished) { throw std::runtime_error("tens: builder finished"); }
+    if (m_msg.payload().size() != m_part) {
+        throw std::runtime_error("tens: parts added during packing");
+    }
+    const size_t offset = (m_used + m_alignment - 1) & ~(m_alignment - 1);
+    reserve(offset + nbytes);
+    if (offset > m_used) { memset(m_pack + m_used, 0, offset - m_used); }
+    uint32_t crc = 0;
+    if (m_checksums) { crc = crc32c_copy(m_pack + offset, data, nbytes); }
+    else if (nbytes) {
+        memcpy(m_pack + offset, data, nbytes);
+    }
+    append_record(m_desc, shape, word, dtype, m_part, m_checksums, crc,
+                  true, offset);
+    m_used = offset + nbytes;
+    ++m_count;
+}
+
+void zio::tens::Builder::add(zio::message_t&& data,
+                             const std::vector<size_t>& shape, size_t word,
+                             const std::string& dtype, bool has_crc,
+                             uint32_t crc)
+{
+    if (m_finished) { throw std::runtime_error("tens: builder finished"); }
+    append_record(m_desc, shape, word, dtype, m_msg.payload().size(), has_crc,
+                  crc);
+    m_msg.add(std::move(data));
+    ++m_count;
+}
+
+void zio::tens::Builder::append(zio::message_t&& data,
+                                const std::vector<size_t>& shape, size_t word,
+                                const std::string& dtype)
+{
+    if (packed()) {
+        pack(data.data(), data.size(), shape, word, dtype);
+        return;
+    }
+    if (!m_checksums) {
+        add(std::move(data), shape, word, dtype, false, 0);
+        return;
+    }
+    const uint32_t crc = crc32c(data.data(), data.size());
+    add(std::move(data), shape, word, dtype, true, crc);
+}
+
+void zio::tens::Builder::append_copy(const void* data, size_t nbytes,
+                                     const std::vector<size_t>& shape,
+                                     size_t word, const std::string& dtype)
+{
+    if (packed()) {
+        pack(data, nbytes, shape, word, dtype);
+        return;
+    }
+    if (!m_checksums) {
+        add(zio::message_t(data, nbytes), shape, word, dtype, false, 0);
+        return;
+    }
+    zio::message_t part(nbytes);
+    const uint32_t crc = crc32c_copy(part.data(), data, nbytes);
+    add(std::move(part), shape, word, dtype, true, crc);
+}
+
+void zio::tens::Builder::finish()
+{
+    if (m_finished) { return; }
+    if (packed()) {
+        if (m_msg.payload().size() != m_part) {
+            throw std::runtime_error("tens: parts added during packing");
+        }
+        if (m_pack) {
+            m_msg.add(zio::message_t(m_pack, m_used, release_pack, nullptr));
+        }
+        else {
+            m_msg.add(zio::message_t());
+        }
+        m_pack = nullptr;
+    }
+    m_finished = true;
+    put_int_at<uint32_t>(m_desc, desc_header_size - 4, m_count);
+    auto& lobj = m_msg.label_object_ref();
+    if (!lobj.is_object()) { lobj = zio::json::value_t::object; }
+    lobj[zio::tens::form]["descriptor"] = m_msg.payload().size();
+    m_msg.add(zio::message_t(m_desc.data(), m_desc.size()));
+}
+
+size_t zio::tens::Reassembler::add(const Message& msg)
+{
+    size_t nchunks = 0;
+    Reader reader(msg);
+    for (size_t index = 0; index < reader.size(); ++index) {
+        const auto& ref = reader.ref(index);
+        if (ref.chunk.empty() or !ref or ref.sparse()) { continue; }
+        // The offset is untrusted so do not let it wrap.
+        if (ref.shape.empty() or ref.offset > ref.total or
+            ref.shape[0] > ref.total - ref.offset) {
+            throw std::runtime_error("tens: chunk outside of tensor");
+        }
+        if (ref.strides != c_strides(ref.shape)) {
+            throw std::runtime_error("tens: chunk not in C order");
+        }
+        if (!ref.verify()) {
+            throw std::runtime_error("tens: chunk fails checksum for " +
+                                     ref.chunk);
+        }
+        auto full = ref.shape;
+        full[0] = ref.total;
 
-    if (md.is_null()) { return bogus; }
-    size_t part = index;
-    if (md["part"].is_number()) { part = md["part"].get<size_t>(); }
-    if (part < 0 or part >= msg.payload().size()) { return bogus; }
-    return msg.payload()[part];
+        auto it = m_tensors.find(ref.chunk);
+        if (it == m_tensors.end()) {
+            Whole one;
+            one.dtype = ref.dtype;
+            one.word = ref.word;
+            one.shape = full;
+            // The total is untrusted so bound the buffer it sizes.
+            size_t nbytes = ref.word;
+            for (size_t dim = 0; dim < full.size(); ++dim) {
+                if (full[dim] and nbytes > m_max_bytes / full[dim]) {
+                    throw std::runtime_error("tens: chunked tensor too big " +
+                                             ref.chunk);
+                }
+                nbytes *= full[dim];
+            }
+            one.row_bytes = ref.word;
+            for (size_t dim = 1; dim < full.size(); ++dim) {
+                one.row_bytes *= full[dim];
+            }
+            one.data = aligned_message(one.row_bytes * ref.total,
+                                       default_alignment);
+            it = m_tensors.emplace(ref.chunk, std::move(one)).first;
+        }
+        auto& one = it->second;
+        if (one.shape != full or one.dtype != ref.dtype or
+            one.word != ref.word) {
+            throw std::runtime_error("tens: chunk mismatch for " + ref.chunk);
+        }
+        if (ref.nbytes) {
+            memcpy(one.data.data<char>() + ref.offset * one.row_bytes,
+                   ref.data, ref.nbytes);
+        }
+
+        // Merge the rows into the arrived intervals.
+        size_t beg = ref.offset, end = ref.offset + ref.shape[0];
+        auto& rows = one.rows;
+        auto after = rows.upper_bound(beg);
+        if (after != rows.begin()) {
+            auto before = std::prev(after);
+            if (before->second >= beg) {
+                beg = before->first;
+                end = std::max(end, before->second);
+                rows.erase(before);
+            }
+        }
+        while (after != rows.end() and after->first <= end) {
+            end = std::max(end, after->second);
+            after = rows.erase(after);
+        }
+        rows[beg] = end;
+        ++nchunks;
+    }
+    return nchunks;
+}
+
+std::vector<std::string> zio::tens::Reassembler::ids() const
+{
+    std::vector<std::string> ret;
+    for (const auto& one : m_tensors) { ret.push_back(one.first); }
+    return ret;
+}
+
+bool zio::tens::Reassembler::has(const std::string& id) const
+{
+    return m_tensors.find(id) != m_tensors.end();
+}
+
+size_t zio::tens::Reassembler::ready(const std::string& id) const
+{
+    auto it = m_tensors.find(id);
+    if (it == m_tensors.end()) { return 0; }
+    const auto& rows = it->second.rows;
+    if (rows.empty() or rows.begin()->first != 0) { return 0; }
+    return rows.begin()->second;
+}
+
+bool zio::tens::Reassembler::complete(const std::string& id) const
+{
+    return has(id) and ready(id) == m_tensors.at(id).shape[0];
+}
+
+zio::tens::TensorRef zio::tens::Reassembler::ref(const std::string& id) const
+{
+    const auto& one = m_tensors.at(id);
+    TensorRef ret;
+    ret.data = one.data.data();
+    ret.nbytes = one.data.size();
+    ret.dtype = one.dtype;
+    ret.word = one.word;
+    ret.shape = one.shape;
+    ret.strides = c_strides(one.shape);
+    return ret;
+}
+
+zio::message_t zio::tens::Reassembler::take(const std::string& id)
+{
+    auto it = m_tensors.find(id);
+    if (it == m_tensors.end()) { return message_t(); }
+    message_t ret = std::move(it->second.data);
+    m_tensors.erase(it);
+    return ret;
+}
+
+static std::atomic<size_t> align_copies{0}, align_bytes{0};
+
+size_t zio::tens::align(Message& msg, size_t alignment)
+{
+    if ((alignment & (alignment - 1)) != 0) {
+        throw std::runtime_error("tens: alignment must be a power of two");
+    }
+    // Find parts needing a copy before touching the message.
+    std::vector<size_t> todo;
+    {
+        Reader reader(msg);
+        std::vector<const void*> ptrs;
+        for (size_t index = 0; index < reader.size(); ++index) {
+            const auto& ref = reader.ref(index);
+            for (const void* ptr : {ref.data, ref.indices, ref.indptr}) {
+                if (ptr and !is_aligned(ptr, alignment)) {
+                    ptrs.push_back(ptr);
+                }
+            }
+        }
+        if (ptrs.empty()) { return 0; }
+        // A packed part holds many tensors, copy it once.
+        const auto& payload = msg.payload();
+        for (size_t ind = 0; ind < payload.size(); ++ind) {
+            const char* beg = payload[ind].data<char>();
+            const char* end = beg + payload[ind].size();
+            for (const void* ptr : ptrs) {
+                if (beg <= ptr and ptr < end) {
+                    todo.push_back(ind);
+                    break;
+                }
+            }
+        }
+    }
+
+    const auto remid = msg.remote_id();
+    auto mmsg = std::move(msg).toparts();
+    size_t nbytes = 0;
+    for (size_t ind : todo) {
+        auto& part = mmsg[ind + 2];
+        nbytes += part.size();
+        part = aligned_message(part.data(), part.size(), alignment);
+    }
+    msg.fromparts(std::move(mmsg));
+    msg.set_remote_id(remid);
+    align_copies += todo.size();
+    align_bytes += nbytes;
+    return todo.size();
+}
+
+zio::tens::AlignStats zio::tens::align_stats()
+{
+    return AlignStats{align_copies.load(), align_bytes.load()};
+}
+
+void zio::tens::reset_align_stats()
+{
+    align_copies = 0;
+    align_bytes = 0;
 }
@@ -3,8 +3,19 @@
 #include <chrono>
 #include <thread>
 #include <sstream>
+#include <memory>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
 #include <signal.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define ZIO_CRC32C_SSE42
+#endif
+
 using namespace zio;
 
 int zio::sock_type(const zio::socket_t& sock)
@@ -44,6 +55,164 @@ std::string zio::binstr(const std::string& s)
     return ss.str();
 }
 
+// Parts smaller than this are cheaper to copy than to share.
+static const size_t decode_adopt_min_size = 256;
+
+static void release_shared(void* /*data*/, void* hint)
+{
+    delete static_cast<std::shared_ptr<const void>*>(hint);
+}
+
+zio::message_t zio::shared_message(const void* data, size_t size,
+                                   std::shared_ptr<const void> owner)
+{
+    auto hint = std::make_unique<std::shared_ptr<const void>>(std::move(owner));
+    // libzmq only reads the data, the const_cast is for its C API.
+    zio::message_t part(const_cast<void*>(data), size, release_shared,
+                        hint.get());
+    hint.release();  // now owned by the part
+    return part;
+}
+
+static void release_aligned(void* data, void* /*hint*/) { std::free(data); }
+
+zio::message_t zio::aligned_message(size_t size, size_t alignment)
+{
+    if (!size) { return zio::message_t(); }
+    if (alignment < sizeof(void*)) { alignment = sizeof(void*); }
+    // aligned_alloc() requires a multiple of the alignment.
+    const size_t padded = (size + alignment - 1) & ~(alignment - 1);
+    void* data = std::aligned_alloc(alignment, padded);
+    if (!data) { throw std::bad_alloc(); }
+    return zio::message_t(data, size, release_aligned, nullptr);
+}
+
+zio::message_t zio::aligned_message(const void* data, size_t size,
+                                    size_t alignment)
+{
+    auto part = aligned_message(size, alignment);
+    if (size) { memcpy(part.data(), data, size); }
+    return part;
+}
+
+// Software CRC-32C, eight bytes at a time.
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char* data, size_t size)
+{
+    static const auto table = []() {
+        std::array<std::array<uint32_t, 256>, 8> tab{};
+        for (uint32_t ind = 0; ind < 256; ++ind) {
+            uint32_t val = ind;
+            for (int bit = 0; bit < 8; ++bit) {
+                val = (val >> 1) ^ (0x82f63b78 & (0 - (val & 1)));
+            }
+            tab[0][ind] = val;
+        }
+        for (uint32_t ind = 0; ind < 256; ++ind) {
+            for (size_t sl = 1; sl < 8; ++sl) {
+                const uint32_t prev = tab[sl - 1][ind];
+                tab[sl][ind] = (prev >> 8) ^ tab[0][prev & 0xff];
+            }
+        }
+        return tab;
+    }();
+
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        word ^= crc;  // little endian
+        crc = table[7][word & 0xff] ^ table[6][(word >> 8) & 0xff] ^
+              table[5][(word >> 16) & 0xff] ^ table[4][(word >> 24) & 0xff] ^
+              table[3][(word >> 32) & 0xff] ^ table[2][(word >> 40) & 0xff] ^
+              table[1][(word >> 48) & 0xff] ^ table[0][word >> 56];
+    }
+    for (; size; --size, ++data) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef ZIO_CRC32C_SSE42
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_hw(uint32_t crc, const unsigned char* data, size_t size)
+{
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; size; --size, ++data) { crc = _mm_crc32_u8(crc, *data); }
+    return crc;
+}
+#endif
+
+uint32_t zio::crc32c(const void* data, size_t size, uint32_t crc)
+{
+    const auto* bytes = (const unsigned char*)data;
+#ifdef ZIO_CRC32C_SSE42
+    static const bool have_sse42 = __builtin_cpu_supports("sse4.2");
+    if (have_sse42) { return ~crc32c_hw(~crc, bytes, size); }
+#endif
+    return ~crc32c_sw(~crc, bytes, size);
+}
+
+uint32_t zio::crc32c_copy(void* dst, const void* src, size_t size, uint32_t crc)
+{
+    // Small enough to stay in L1 between the copy and the CRC.
+    const size_t block = 16384;
+    auto* to = (char*)dst;
+    const auto* from = (const char*)src;
+    for (size_t done = 0; done < size; done += block) {
+        const size_t num = std::min(block, size - done);
+        memcpy(to + done, from + done, num);
+        crc = crc32c(to + done, num, crc);
+    }
+    return crc;
+}
+
+void zio::decode_adopt(zio::message_t&& encoded, zio::multipart_t& mmsg)
+{
+    // The encoded message is only moved to shared ownership once a
+    // part needs it so small messages cost no extra allocation.
+    std::shared_ptr<zio::message_t> held;
+    unsigned char* source = encoded.data<unsigned char>();
+    const unsigned char* limit = source + encoded.size();
+
+    // This follows the encoding of zio::encode().
+    while (source < limit) {
+        size_t part_size = *source++;
+        if (part_size == std::numeric_limits<std::uint8_t>::max()) {
+            if (source > limit - 4) {
+                throw std::out_of_range(
+                    "Malformed encoding, overflow in reading size");
+            }
+            part_size = ((uint32_t)source[0] << 24) +
+                        ((uint32_t)source[1] << 16) +
+                        ((uint32_t)source[2] << 8) + (uint32_t)source[3];
+            source += 4;
+        }
+        if (source > limit - part_size) {
+            throw std::out_of_range(
+                "Malformed encoding, overflow in reading part");
+        }
+        if (part_size < decode_adopt_min_size) {
+            mmsg.addmem(source, part_size);
+        }
+        else {
+            if (!held) {
+                const size_t offset = source - encoded.data<unsigned char>();
+                const size_t total = encoded.size();
+                held = std::make_shared<zio::message_t>(std::move(encoded));
+                source = held->data<unsigned char>() + offset;
+                limit = held->data<unsigned char>() + total;
+            }
+            mmsg.add(shared_message(source, part_size, held));
+        }
+        source += part_size;
+    }
+}
+
 bool zio::is_serverish(zio::socket_t& sock)
 {
     int stype = sock.get(zmq::sockopt::type);
@@ -61,8 +230,8 @@ zio::recv_result_t zio::recv_serverish(zio::socket_t& sock,
                                        recv_flags flags)
 {
     int stype = sock.get(zmq::sockopt::type);
-    if (ZMQ_SERVER == stype) { return recv_server(sock, mmsg, remid); }
-    if (ZMQ_ROUTER == stype) { return recv_router(sock, mmsg, remid); }
+    if (ZMQ_SERVER == stype) { return recv_server(sock, mmsg, remid, flags); }
+    if (ZMQ_ROUTER == stype) { return recv_router(sock, mmsg, remid, flags); }
     throw std::runtime_error("recv requires SERVER or ROUTER socket");
 }
 
@@ -72,10 +241,10 @@ zio::recv_result_t zio::recv_server(zio::socket_t& server_socket,
                                     recv_flags flags)
 {
     zio::message_t msg;
-    auto res = server_socket.recv(msg, zio::recv_flags::none);
+    auto res = server_socket.recv(msg, flags);
     if (!res) { return res; }
     remid = to_remid(msg.routing_id());
-    mmsg.decode_append(msg);
+    decode_adopt(std::move(msg), mmsg);
     return res;
 }
 
@@ -84,11 +253,10 @@ zio::recv_result_t zio::recv_router(zio::socket_t& router_socket,
                                     zio::remote_identity_t& remid,
                                     recv_flags flags)
 {
-    auto res = mmsg.recv(router_socket);
-    if (!res) { return res; }
+    if (!mmsg.recv(router_socket, static_cast<int>(flags))) { return {}; }
     remid = mmsg.popstr();
     mmsg.pop();  // delimiter
-    return res;
+    return mmsg.size();
 }
 
 zio::send_result_t zio::send_serverish(zio::socket_t& sock,
@@ -129,8 +297,8 @@ zio::recv_result_t zio::recv_clientish(zio::socket_t& socket,
                                        zio::multipart_t& mmsg, recv_flags flags)
 {
     int stype = socket.get(zmq::sockopt::type);
-    if (ZMQ_CLIENT == stype) { return recv_client(socket, mmsg); }
-    if (ZMQ_DEALER == stype) { return recv_dealer(socket, mmsg); }
+    if (ZMQ_CLIENT == stype) { return recv_client(socket, mmsg, flags); }
+    if (ZMQ_DEALER == stype) { return recv_dealer(socket, mmsg, flags); }
     throw std::runtime_error("recv requires CLIENT or DEALER socket");
 }
 
@@ -138,19 +306,18 @@ zio::recv_result_t zio::recv_client(zio::socket_t& client_socket,
                                     zio::multipart_t& mmsg, recv_flags flags)
 {
     zio::message_t msg;
-    auto res = client_socket.recv(msg, zio::recv_flags::none);
+    auto res = client_socket.recv(msg, flags);
     if (!res) { return res; }
-    mmsg.decode_append(msg);
+    decode_adopt(std::move(msg), mmsg);
     return res;
 }
 
 zio::recv_result_t zio::recv_dealer(zio::socket_t& dealer_socket,
                                     zio::multipart_t& mmsg, recv_flags flags)
 {
-    auto res = mmsg.recv(dealer_socket);
-    if (!res) { return res; }
+    if (!mmsg.recv(dealer_socket, static_cast<int>(flags))) { return {}; }
     mmsg.pop();  // fake being REQ
-    return res;
+    return mmsg.size();
 }
 
 zio::send_result_t zio::send_clientish(zio::socket_t& socket,
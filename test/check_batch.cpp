@@ -0,0 +1,81 @@
+/** Benchmark of sending small messages with and without batching.
+ *
+ * A CLIENT port sends to a SERVER port receiving in another thread.
+ *
+ *   check_batch [count] [payload size] [batch size]
+ */
+
+#include "zio/node.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+#include "zio/stopwatch.hpp"
+
+#include <cstdlib>
+#include <thread>
+
+static double run(const std::string& address, size_t num, size_t siz,
+                  size_t batch)
+{
+    zio::Node node("check-batch");
+    auto server = node.port("server", ZMQ_SERVER);
+    auto client = node.port("client", ZMQ_CLIENT);
+    server->bind(address);
+    client->connect(address);
+    node.online();
+    client->set_batching(batch);
+
+    // The first message can be slow as the connection is made.
+    zio::Message msg("TEXT");
+    client->send(msg);
+    client->flush();
+    server->recv(msg);
+
+    zio::Stopwatch sw;
+    sw.start();
+    std::thread recver([&]() {
+        zio::Message got;
+        for (size_t ind = 0; ind < num; ++ind) {
+            if (!server->recv(got, zio::timeout_t{1000})) {
+                zio::error("timeout after {} messages", ind);
+                return;
+            }
+        }
+    });
+
+    std::string payload(siz, 'x');
+    for (size_t ind = 0; ind < num; ++ind) {
+        msg.clear_payload();
+        msg.add(zio::message_t(payload.data(), payload.size()));
+        client->send(msg);
+    }
+    client->flush();
+    recver.join();
+    sw.stop();
+
+    node.offline();
+    return sw.hz(num);
+}
+
+int main(int argc, char* argv[])
+{
+    zio::init_all();
+
+    size_t num = 100000;
+    size_t siz = 16;
+    size_t batch = 100;
+    if (argc > 1) { num = atol(argv[1]); }
+    if (argc > 2) { siz = atol(argv[2]); }
+    if (argc > 3) { batch = atol(argv[3]); }
+
+    zio::info("{} messages with {} byte payload, batches of {}", num, siz,
+              batch);
+
+    for (std::string address :
+         {"tcp://127.0.0.1:5558", "ipc:///tmp/check_batch.ipc"}) {
+        const double single = run(address, num, siz, 0);
+        const double batched = run(address, num, siz, batch);
+        zio::info("{:>28}: single {:8.3f} kHz, batched {:8.3f} kHz, x{:.1f}",
+                  address, 1e-3 * single, 1e-3 * batched, batched / single);
+    }
+    return 0;
+}
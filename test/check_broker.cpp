@@ -0,0 +1,120 @@
+/** Benchmark of the flow broker routing many flows.
+ *
+ * Client threads give DAT through a zio::flow::Broker to handler
+ * threads which the broker's factory starts in this process.  Compare
+ * with python/tests/check_flowbroker.py for the Python broker.
+ *
+ *   check_broker [clients] [messages per client] [credit]
+ */
+
+#include "zio/flow/broker.hpp"
+#include "zio/node.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+#include "zio/stopwatch.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+static void giver(zio::portptr_t port, size_t ndats, int credit)
+{
+    zio::Flow flow(port, zio::flow::direction_e::extract, credit);
+    bool ok = flow.bot();
+    assert(ok);
+    for (size_t ind = 0; ind < ndats; ++ind) {
+        zio::Message dat("FLOW");
+        ok = flow.put(dat);
+        assert(ok);
+    }
+    ok = flow.eot();
+    assert(ok);
+}
+
+static void handler(zio::portptr_t port, zio::Message bot, size_t ndats,
+                    std::atomic<size_t>& ntaken)
+{
+    zio::flow::Label lab(bot);
+    zio::Flow flow(port, lab.direction(), lab.credit());
+    bool ok = flow.bot(bot);
+    assert(ok);
+    size_t count = 0;
+    while (true) {
+        zio::Message dat;
+        try {
+            ok = flow.get(dat);
+        } catch (const zio::flow::end_of_transmission&) {
+            flow.eotack();
+            break;
+        }
+        assert(ok);
+        ++count;
+    }
+    assert(count == ndats);
+    ntaken += count;
+}
+
+int main(int argc, char* argv[])
+{
+    zio::init_all();
+
+    size_t nclients = 10;
+    size_t ndats = 10000;
+    int credit = 10;
+    if (argc > 1) { nclients = atol(argv[1]); }
+    if (argc > 2) { ndats = atol(argv[2]); }
+    if (argc > 3) { credit = atoi(argv[3]); }
+    zio::info("{} clients of {} DAT with {} credit", nclients, ndats, credit);
+
+    const std::string address = "tcp://127.0.0.1:5562";
+    zio::Node node("check-broker");
+    auto server = node.port("server", ZMQ_SERVER);
+    server->bind(address);
+    std::vector<zio::portptr_t> cports, hports;
+    for (size_t ind = 0; ind < nclients; ++ind) {
+        const std::string num = std::to_string(ind);
+        cports.push_back(node.port("client" + num, ZMQ_CLIENT));
+        cports.back()->connect(address);
+        hports.push_back(node.port("handler" + num, ZMQ_CLIENT));
+        hports.back()->connect(address);
+    }
+    node.online();
+
+    // An in-process factory.  One starting handlers in other
+    // processes would instead pass the BOT and broker address on.
+    std::atomic<size_t> ntaken{0};
+    std::vector<std::thread> handlers;
+    auto factory = [&](zio::Message& bot) -> bool {
+        if (handlers.size() == hports.size()) { return false; }
+        auto port = hports[handlers.size()];
+        handlers.emplace_back(handler, port, std::move(bot), ndats,
+                              std::ref(ntaken));
+        return true;
+    };
+    zio::flow::Broker broker(server, factory);
+
+    zio::Stopwatch sw;
+    sw.start();
+    std::vector<std::thread> clients;
+    for (auto port : cports) {
+        clients.emplace_back(giver, port, ndats, credit);
+    }
+
+    size_t nrouted = 0;
+    while (ntaken < nclients * ndats or broker.size()) {
+        const size_t got = broker.poll(zio::timeout_t{1000});
+        if (!got) {
+            zio::error("broker timeout after {} messages", nrouted);
+            return 1;
+        }
+        nrouted += got;
+    }
+    for (auto& th : clients) { th.join(); }
+    for (auto& th : handlers) { th.join(); }
+    sw.stop();
+
+    zio::info("routed {} messages, {:.3f} kHz, DAT {:.3f} kHz", nrouted,
+              1e-3 * sw.hz(nrouted), 1e-3 * sw.hz(ntaken));
+    node.offline();
+    return 0;
+}
@@ -0,0 +1,82 @@
+/** Benchmark of payload compression throughput against ratio.
+ *
+ * Each available codec compresses a message holding simulated ADC
+ * waveforms using a varying number of threads.
+ *
+ *   check_compress [parts] [samples per part] [repeats]
+ */
+
+#include "zio/codec.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+#include "zio/stopwatch.hpp"
+
+#include <cstdlib>
+#include <random>
+
+// Baseline plus noise with an occasional pulse, as 12 bit samples.
+static std::vector<int16_t> waveform(size_t nsamples, std::mt19937& rng)
+{
+    std::normal_distribution<float> noise(0, 3);
+    std::uniform_int_distribution<size_t> where(0, nsamples);
+    std::vector<int16_t> adc(nsamples);
+    for (auto& one : adc) { one = 2048 + noise(rng); }
+    for (int pulse = 0; pulse < 10; ++pulse) {
+        const size_t beg = where(rng);
+        for (size_t ind = beg; ind < std::min(beg + 20, nsamples); ++ind) {
+            adc[ind] += 500 / (1 + ind - beg);
+        }
+    }
+    return adc;
+}
+
+int main(int argc, char* argv[])
+{
+    zio::init_all();
+
+    size_t nparts = 8;
+    size_t nsamples = 1 << 20;
+    size_t nrepeat = 5;
+    if (argc > 1) { nparts = atol(argv[1]); }
+    if (argc > 2) { nsamples = atol(argv[2]); }
+    if (argc > 3) { nrepeat = atol(argv[3]); }
+
+    std::mt19937 rng(42);
+    zio::Message orig("TENS");
+    for (size_t ind = 0; ind < nparts; ++ind) {
+        auto adc = waveform(nsamples, rng);
+        orig.add(zio::message_t(adc.data(), adc.size() * sizeof(int16_t)));
+    }
+    const auto parts = orig.toparts();
+    const double mbytes = 1e-6 * nparts * nsamples * sizeof(int16_t);
+    zio::info("{} parts of {} samples, {:.1f} MB", nparts, nsamples, mbytes);
+
+    for (const auto& name : zio::codec::names()) {
+        auto codec = zio::codec::get(name);
+        for (size_t nthreads : {1, 2, 4, 8}) {
+            zio::Stopwatch czip, unzip;
+            size_t zipped = 0;
+            for (size_t rep = 0; rep < nrepeat; ++rep) {
+                zio::multipart_t mmsg;
+                for (const auto& part : parts) {
+                    mmsg.addmem(part.data(), part.size());
+                }
+                czip.start();
+                zio::codec::compress(mmsg, *codec, 0, nthreads);
+                czip.stop();
+                zipped = 0;
+                for (size_t ind = 2; ind < mmsg.size(); ++ind) {
+                    zipped += mmsg[ind].size();
+                }
+                unzip.start();
+                zio::codec::decompress(mmsg);
+                unzip.stop();
+            }
+            zio::info("{:>5} x{}: ratio {:5.2f}, compress {:8.1f} MB/s, "
+                      "decompress {:8.1f} MB/s",
+                      name, nthreads, mbytes / (1e-6 * zipped),
+                      mbytes * czip.hz(nrepeat), mbytes * unzip.hz(nrepeat));
+        }
+    }
+    return 0;
+}
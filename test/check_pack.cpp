@@ -0,0 +1,114 @@
+/** Benchmark of sending many tensors as many frames or packed in one.
+ *
+ * A client port sends TENS messages made by a tens::Builder to a
+ * server port which receives them, with tensor alignment, in another
+ * thread and reads every tensor.
+ *
+ * Both layouts are run over CLIENT/SERVER, where Message::encode()
+ * turns either into one frame, and over DEALER/ROUTER, where the
+ * unpacked tensors go to libzmq as many frames.
+ *
+ *   check_pack [messages] [tensors per message] [tensor bytes]
+ */
+
+#include "zio/node.hpp"
+#include "zio/tens.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+#include "zio/stopwatch.hpp"
+
+#include <cstdlib>
+#include <thread>
+
+static double run(const std::string& address, int ctype, int stype,
+                  size_t num, size_t ntens, size_t nbytes, bool packed)
+{
+    zio::Node node("check-pack");
+    auto server = node.port("server", stype);
+    auto client = node.port("client", ctype);
+    server->bind(address);
+    client->connect(address);
+    node.online();
+    server->set_tensor_alignment(zio::tens::default_alignment);
+
+    // The first message can be slow as the connection is made.
+    zio::Message msg("TEXT");
+    client->send(msg);
+    server->recv(msg);
+
+    const std::vector<uint8_t> chan(nbytes, 1);
+    const std::vector<size_t> shape{nbytes};
+
+    zio::Stopwatch sw;
+    sw.start();
+    std::thread recver([&]() {
+        zio::Message got;
+        size_t check = 0;
+        for (size_t ind = 0; ind < num; ++ind) {
+            if (!server->recv(got, zio::timeout_t{1000})) {
+                zio::error("timeout after {} messages", ind);
+                return;
+            }
+            zio::tens::Reader reader(got);
+            for (size_t index = 0; index < reader.size(); ++index) {
+                check += reader.view<uint8_t>(index)(0);
+            }
+        }
+        zio::debug("checksum {}", check);
+    });
+
+    for (size_t ind = 0; ind < num; ++ind) {
+        zio::Message tmsg(zio::tens::form);
+        if (packed) {
+            zio::tens::Builder builder(tmsg, ntens * nbytes);
+            for (size_t index = 0; index < ntens; ++index) {
+                builder.append(chan.data(), shape);
+            }
+            builder.finish();
+        }
+        else {
+            zio::tens::Builder builder(tmsg);
+            for (size_t index = 0; index < ntens; ++index) {
+                builder.append(chan.data(), shape);
+            }
+            builder.finish();
+        }
+        client->send(tmsg);
+    }
+    recver.join();
+    sw.stop();
+
+    node.offline();
+    return sw.hz(num);
+}
+
+int main(int argc, char* argv[])
+{
+    zio::init_all();
+
+    size_t num = 100;
+    size_t ntens = 1000;
+    size_t nbytes = 4096;
+    if (argc > 1) { num = atol(argv[1]); }
+    if (argc > 2) { ntens = atol(argv[2]); }
+    if (argc > 3) { nbytes = atol(argv[3]); }
+
+    zio::info("{} messages of {} tensors of {} bytes", num, ntens, nbytes);
+
+    const double mb = 1e-6 * ntens * nbytes;
+    const std::vector<std::pair<int, int>> stypes{{ZMQ_CLIENT, ZMQ_SERVER},
+                                                  {ZMQ_DEALER, ZMQ_ROUTER}};
+    for (std::string address :
+         {"tcp://127.0.0.1:5560", "ipc:///tmp/check_pack.ipc"}) {
+        for (const auto& st : stypes) {
+            const double frames =
+                run(address, st.first, st.second, num, ntens, nbytes, false);
+            const double packed =
+                run(address, st.first, st.second, num, ntens, nbytes, true);
+            zio::info("{:>28} {:>6}: frames {:8.1f} MB/s, packed {:8.1f} MB/s, x{:.1f}",
+                      address, st.first == ZMQ_CLIENT ? "CLIENT" : "DEALER",
+                      mb * frames, mb * packed, packed / frames);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+/** Micro-benchmark of prefix header encoding and decoding.
+ *
+ * Compares the original stringstream/substr based codec with the
+ * allocation-free PrefixHeader::dump() and PrefixHeaderView, and
+ * producing message parts from a Message against a HeaderTemplate.
+ *
+ *   check_prefix [count] [label size]
+ */
+
+#include "zio/message.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+#include "zio/stopwatch.hpp"
+
+#include <sstream>
+#include <cstdlib>
+
+// The codec as it was originally implemented.
+static std::string legacy_dumps(const zio::PrefixHeader& ph)
+{
+    std::stringstream ss;
+    char num = '0' + ph.level;
+    ss << "ZIO" << num << ph.form;
+    if (ph.label.size() > 0) { ss << ph.label; }
+    return ss.str();
+}
+static bool legacy_loads(zio::PrefixHeader& ph, const std::string& p)
+{
+    const size_t siz = p.size();
+    if (siz < 8) return false;
+    if (p.substr(0, 3) != "ZIO") return false;
+    ph.level = static_cast<zio::level::MessageLevel>(p[3] - '0');
+    ph.form = p.substr(4, 4);
+    ph.label = p.substr(8);
+    return true;
+}
+
+static void report(const std::string& what, zio::Stopwatch& sw, size_t num)
+{
+    const double hz = sw.hz(num);
+    zio::info("{:>16}: {:8.3f} MHz", what, 1e-6 * hz);
+}
+
+int main(int argc, char* argv[])
+{
+    zio::init_all();
+
+    size_t num = 1000000;
+    size_t labsiz = 32;
+    if (argc > 1) { num = atol(argv[1]); }
+    if (argc > 2) { labsiz = atol(argv[2]); }
+
+    zio::PrefixHeader ph{zio::level::info, "FLOW", std::string(labsiz, 'x')};
+    zio::info("{} iterations with label of {} bytes", num, labsiz);
+
+    size_t check = 0;  // defeat optimizer
+    zio::Stopwatch sw;
+
+    {
+        zio::message_t part;
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            const std::string s = legacy_dumps(ph);
+            part.rebuild(s.data(), s.size());
+            check += part.size();
+        }
+        sw.stop();
+        report("legacy dumps", sw, num);
+    }
+    {
+        zio::message_t part;
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            ph.dump(part);
+            check += part.size();
+        }
+        sw.stop();
+        report("dump", sw, num);
+    }
+
+    zio::message_t part;
+    ph.dump(part);
+    {
+        zio::PrefixHeader got;
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            std::string s(part.data<const char>(), part.size());
+            legacy_loads(got, s);
+            check += got.label.size();
+        }
+        sw.stop();
+        report("legacy loads", sw, num);
+    }
+    {
+        zio::PrefixHeader got;
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            zio::PrefixHeaderView view;
+            view.loads(part);
+            got.loads(view);
+            check += got.label.size();
+        }
+        sw.stop();
+        report("view loads", sw, num);
+    }
+    {
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            zio::PrefixHeaderView view;
+            view.loads(part);
+            check += view.label.size();
+        }
+        sw.stop();
+        report("view only", sw, num);
+    }
+
+    {
+        zio::Message msg("FLOW", zio::level::info);
+        msg.set_label(ph.label);
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            msg.add(zio::message_t(16));
+            msg.set_coord();
+            msg.set_seqno(ind);
+            auto parts = std::move(msg).toparts();
+            check += parts.size();
+        }
+        sw.stop();
+        report("message toparts", sw, num);
+    }
+    {
+        zio::HeaderTemplate head(ph);
+        sw.restart();
+        for (size_t ind = 0; ind < num; ++ind) {
+            zio::multipart_t payload;
+            payload.add(zio::message_t(16));
+            auto parts = head.toparts(std::move(payload));
+            check += parts.size();
+        }
+        sw.stop();
+        report("template toparts", sw, num);
+    }
+
+    zio::debug("checksum {}", check);
+    return 0;
+}
@@ -0,0 +1,94 @@
+/** Benchmark of TENS messages holding many tensors.
+ *
+ * Compares tensors described in the label JSON with those described
+ * in a binary descriptor part for building, serializing and reading.
+ *
+ *   check_tens [tensors] [elements per tensor] [repeats]
+ */
+
+#include "zio/tens.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+#include "zio/stopwatch.hpp"
+
+#include <cstdlib>
+
+static size_t read_all(const zio::Message& msg)
+{
+    size_t check = 0;
+    zio::tens::Reader reader(msg);
+    for (size_t ind = 0; ind < reader.size(); ++ind) {
+        auto view = reader.view<int16_t>(ind);
+        if (view) { check += view(0); }
+    }
+    return check;
+}
+
+int main(int argc, char* argv[])
+{
+    zio::init_all();
+
+    size_t ntens = 1000;
+    size_t nelem = 100;
+    size_t nrepeat = 10;
+    if (argc > 1) { ntens = atol(argv[1]); }
+    if (argc > 2) { nelem = atol(argv[2]); }
+    if (argc > 3) { nrepeat = atol(argv[3]); }
+    zio::info("{} tensors of {} int16 elements, {} repeats", ntens, nelem,
+              nrepeat);
+
+    std::vector<int16_t> chan(nelem, 1);
+    const std::vector<size_t> shape{nelem};
+    size_t check = 0;
+
+    {
+        zio::Stopwatch build, read;
+        size_t nlabel = 0;
+        for (size_t rep = 0; rep < nrepeat; ++rep) {
+            build.start();
+            zio::Message msg(zio::tens::form);
+            for (size_t ind = 0; ind < ntens; ++ind) {
+                zio::tens::append(msg, chan.data(), shape);
+            }
+            auto parts = std::move(msg).toparts();
+            build.stop();
+            nlabel = parts[0].size();
+
+            read.start();
+            zio::Message got;
+            got.fromparts(std::move(parts));
+            check += read_all(got);
+            read.stop();
+        }
+        zio::info("json:   build {:8.3f} kHz, read {:8.3f} kHz, {} byte label",
+                  1e-3 * build.hz(nrepeat), 1e-3 * read.hz(nrepeat), nlabel);
+    }
+    {
+        zio::Stopwatch build, read;
+        size_t ndesc = 0;
+        for (size_t rep = 0; rep < nrepeat; ++rep) {
+            build.start();
+            zio::Message msg(zio::tens::form);
+            zio::tens::Builder builder(msg);
+            for (size_t ind = 0; ind < ntens; ++ind) {
+                builder.append(chan.data(), shape);
+            }
+            builder.finish();
+            auto parts = std::move(msg).toparts();
+            build.stop();
+            ndesc = parts[0].size() + parts[parts.size() - 1].size();
+
+            read.start();
+            zio::Message got;
+            got.fromparts(std::move(parts));
+            check += read_all(got);
+            read.stop();
+        }
+        zio::info("binary: build {:8.3f} kHz, read {:8.3f} kHz, {} byte label "
+                  "and descriptor",
+                  1e-3 * build.hz(nrepeat), 1e-3 * read.hz(nrepeat), ndesc);
+    }
+
+    zio::debug("checksum {}", check);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "zio/flow/broker.hpp"
+#include "zio/node.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+
+using namespace zio::flow;
+
+static zio::Message flowmsg(msgtype_e mt, direction_e dir = direction_e::unknown)
+{
+    zio::Message msg("FLOW");
+    Label lab(msg);
+    lab.msgtype(mt);
+    if (dir != direction_e::unknown) {
+        lab.direction(dir);
+        lab.credit(2);
+    }
+    return msg;
+}
+
+static zio::Message expect(zio::portptr_t port, msgtype_e mt)
+{
+    zio::Message msg;
+    bool ok = port->recv(msg, zio::timeout_t{1000});
+    assert(ok);
+    assert(Label(msg).msgtype() == mt);
+    return msg;
+}
+
+static void route(Broker& broker, size_t nmsgs)
+{
+    size_t got = 0;
+    while (got < nmsgs) {
+        const size_t one = broker.poll(zio::timeout_t{1000});
+        assert(one);
+        got += one;
+    }
+}
+
+int main()
+{
+    zio::init_all();
+
+    const std::string address = "tcp://127.0.0.1:5563";
+    zio::Node node("test-broker");
+    auto server = node.port("server", ZMQ_SERVER);
+    server->bind(address);
+    auto client = node.port("client", ZMQ_CLIENT);
+    client->connect(address);
+    auto handler = node.port("handler", ZMQ_CLIENT);
+    handler->connect(address);
+    auto refused = node.port("refused", ZMQ_CLIENT);
+    refused->connect(address);
+    auto stranger = node.port("stranger", ZMQ_CLIENT);
+    stranger->connect(address);
+    node.online();
+
+    // Accept the first client, refuse any other.
+    std::vector<zio::Message> bots;
+    auto factory = [&](zio::Message& bot) -> bool {
+        if (bots.size()) { return false; }
+        bots.push_back(std::move(bot));
+        return true;
+    };
+    Broker broker(server, factory);
+
+    // A non-BOT from an unknown peer is dropped.
+    auto dat = flowmsg(msgtype_e::dat);
+    stranger->send(dat);
+    route(broker, 1);
+    assert(broker.size() == 0);
+    zio::Message none;
+    assert(!stranger->recv(none, zio::timeout_t{100}));
+
+    // The factory receives the client's BOT reversed with its "cid".
+    auto cbot = flowmsg(msgtype_e::bot, direction_e::extract);
+    client->send(cbot);
+    route(broker, 1);
+    assert(bots.size() == 1);
+    Label hlab(bots[0]);
+    assert(hlab.direction() == direction_e::inject);
+    assert(hlab.object().contains("cid"));
+    assert(broker.size() == 0);
+
+    // The handler's BOT, carrying the "cid", pairs the two.
+    handler->send(bots[0]);
+    route(broker, 1);
+    assert(broker.size() == 2);
+    auto got = expect(client, msgtype_e::bot);
+    assert(Label(got).direction() == direction_e::inject);
+    assert(!Label(got).object().contains("cid"));
+    got = expect(handler, msgtype_e::bot);
+    assert(Label(got).direction() == direction_e::extract);
+
+    // Later messages pass by routing ID in both directions.
+    auto pay = flowmsg(msgtype_e::pay);
+    handler->send(pay);
+    route(broker, 1);
+    expect(client, msgtype_e::pay);
+    dat = flowmsg(msgtype_e::dat);
+    dat.add(zio::message_t(std::string("payload").data(), 7));
+    client->send(dat);
+    route(broker, 1);
+    got = expect(handler, msgtype_e::dat);
+    assert(got.payload().size() == 1);
+    assert(got.payload()[0].to_string() == "payload");
+
+    // A refused client is told EOT.
+    auto rbot = flowmsg(msgtype_e::bot, direction_e::inject);
+    refused->send(rbot);
+    route(broker, 1);
+    expect(refused, msgtype_e::eot);
+    assert(broker.size() == 2);
+
+    // The route is kept until both ends have sent EOT.
+    auto eot = flowmsg(msgtype_e::eot);
+    client->send(eot);
+    route(broker, 1);
+    expect(handler, msgtype_e::eot);
+    assert(broker.size() == 2);
+    eot = flowmsg(msgtype_e::eot);
+    handler->send(eot);
+    route(broker, 1);
+    expect(client, msgtype_e::eot);
+    assert(broker.size() == 0);
+
+    // Once torn down, the client is unknown again.
+    dat = flowmsg(msgtype_e::dat);
+    client->send(dat);
+    route(broker, 1);
+    assert(!handler->recv(none, zio::timeout_t{100}));
+
+    node.offline();
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include "zio/codec.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+// A trivial run-length codec so the test does not depend on which
+// builtins are available.
+class RleCodec : public zio::codec::Codec
+{
+  public:
+    std::string name() const { return "rle"; }
+    size_t bound(size_t size) const { return 2 * size; }
+    size_t compress(const void* data, size_t size, void* out) const
+    {
+        const uint8_t* in = (const uint8_t*)data;
+        uint8_t* o = (uint8_t*)out;
+        size_t nout = 0;
+        for (size_t ind = 0; ind < size;) {
+            uint8_t run = 1;
+            while (ind + run < size and run < 255 and in[ind + run] == in[ind]) {
+                ++run;
+            }
+            o[nout++] = run;
+            o[nout++] = in[ind];
+            ind += run;
+        }
+        return nout;
+    }
+    void decompress(const void* data, size_t size, void* out,
+                    size_t out_size) const
+    {
+        const uint8_t* in = (const uint8_t*)data;
+        uint8_t* o = (uint8_t*)out;
+        size_t nout = 0;
+        for (size_t ind = 0; ind + 1 < size; ind += 2) {
+            if (nout + in[ind] > out_size) {
+                throw std::runtime_error("rle overflow");
+            }
+            memset(o + nout, in[ind + 1], in[ind]);
+            nout += in[ind];
+        }
+        if (nout != out_size) { throw std::runtime_error("rle underflow"); }
+    }
+};
+
+// Fails on whichever part it is given first.
+class FailCodec : public RleCodec
+{
+  public:
+    size_t compress(const void* data, size_t size, void* out) const
+    {
+        if (first.exchange(false)) {
+            throw std::runtime_error("fail codec");
+        }
+        return RleCodec::compress(data, size, out);
+    }
+    mutable std::atomic<bool> first{true};
+};
+
+static zio::Message make_message()
+{
+    zio::Message msg("TENS");
+    msg.set_label_object({{"a", 1}});
+    msg.add(zio::message_t(std::string(10, 'x').data(), 10));
+    for (int ind = 0; ind < 5; ++ind) {
+        std::string big(10000, 'a' + ind);
+        msg.add(zio::message_t(big.data(), big.size()));
+    }
+    return msg;
+}
+
+static void check_message(const zio::Message& msg)
+{
+    assert(msg.label_object() == zio::json({{"a", 1}}));
+    assert(msg.payload().size() == 6);
+    assert(msg.payload()[0].size() == 10);
+    for (int ind = 0; ind < 5; ++ind) {
+        const auto& part = msg.payload()[ind + 1];
+        assert(part.size() == 10000);
+        assert(part.data<char>()[9999] == 'a' + ind);
+    }
+}
+
+int main()
+{
+    zio::init_all();
+    for (const auto& name : zio::codec::names()) {
+        zio::debug("builtin codec: {}", name);
+    }
+
+    zio::codec::add(std::make_shared<RleCodec>());
+    auto rle = zio::codec::get("rle");
+    assert(rle);
+    assert(!zio::codec::get("no such codec"));
+
+    for (size_t nthreads : {1, 4}) {
+        auto msg = make_message();
+        assert(zio::codec::compress(msg, *rle, 1000, nthreads));
+        assert(msg.label_object()[zio::codec::key]["name"] == "rle");
+        assert(msg.payload()[0].size() == 10);   // below threshold
+        assert(msg.payload()[1].size() < 1000);  // compressed
+        // already compressed
+        assert(!zio::codec::compress(msg, *rle, 1000, nthreads));
+
+        auto parts = msg.toparts();
+        assert(zio::codec::decompress(parts));
+        zio::Message got;
+        got.fromparts(parts);
+        check_message(got);
+        assert(!zio::codec::decompress(got));
+    }
+
+    // Each builtin round trips.
+    for (const auto& name : zio::codec::names()) {
+        auto msg = make_message();
+        assert(zio::codec::compress(msg, *zio::codec::get(name)));
+        assert(zio::codec::decompress(msg));
+        check_message(msg);
+    }
+
+    // Text labels have no place to record the codec.
+    zio::Message text("TEXT");
+    text.set_label("hello");
+    text.add(zio::message_t(std::string(10000, 'x').data(), 10000));
+    assert(!zio::codec::compress(text, *rle, 1000));
+    assert(text.label() == "hello");
+    assert(text.payload()[0].size() == 10000);
+
+    // An empty label is restored as such.
+    zio::Message empty("TEXT");
+    empty.add(zio::message_t(std::string(10000, 'x').data(), 10000));
+    assert(zio::codec::compress(empty, *rle, 1000));
+    assert(zio::codec::decompress(empty));
+    assert(empty.label().empty());
+
+    // As is an empty object.
+    zio::Message eobj("TEXT");
+    eobj.set_label("{}");
+    eobj.add(zio::message_t(std::string(10000, 'x').data(), 10000));
+    assert(zio::codec::compress(eobj, *rle, 1000));
+    assert(zio::codec::decompress(eobj));
+    assert(eobj.label() == "{}");
+
+    // An application "codec" key is not mistaken for a record.
+    zio::Message app("TEXT");
+    app.set_label_object({{"codec", {{"name", "h264"}}}});
+    app.add(zio::message_t(std::string(10000, 'x').data(), 10000));
+    assert(!zio::codec::decompress(app));
+    assert(zio::codec::compress(app, *rle, 1000));
+    assert(zio::codec::decompress(app));
+    assert(app.label_object()["codec"]["name"] == "h264");
+
+    // Malformed records are rejected without allocating.
+    auto rejects = [&](const zio::json& rec) {
+        zio::Message bad("TEXT");
+        bad.set_label_object({{zio::codec::key, rec}});
+        bad.add(zio::message_t(std::string(10, 'x').data(), 10));
+        try {
+            zio::codec::decompress(bad);
+        }
+        catch (const std::runtime_error& err) {
+            zio::debug("rejected: {}", err.what());
+            return true;
+        }
+        return false;
+    };
+    assert(rejects({{"name", "rle"}, {"sizes", {"ten"}}}));
+    assert(rejects({{"name", "rle"}, {"sizes", {-1}}}));
+    assert(rejects({{"name", 42}, {"sizes", {10}}}));
+    assert(rejects({{"name", "rle"}, {"sizes", {1ULL << 40}}}));
+    assert(rejects({{"name", "rle"}, {"sizes", {0}}, {"empty", 1}}));
+    assert(rejects({{"name", "rle"}, {"sizes", {0}}}));
+
+    // A failing codec throws only once every worker is done.
+    zio::Message many("TEXT");
+    for (int ind = 0; ind < 16; ++ind) {
+        many.add(zio::message_t(std::string(10000, 'x').data(), 10000));
+    }
+    bool threw = false;
+    try {
+        zio::codec::compress(many, FailCodec{}, 1000, 4);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    return 0;
+}
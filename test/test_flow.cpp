@@ -6,7 +6,7 @@
 #include "zio/actor.hpp"
 
 static void flow_endpoint(zio::socket_t& link, int socket, bool giver,
-                          int credit)
+                          int credit, bool adaptive)
 {
     const std::string server_node_name = "test-flow-endpoint-server";
     const std::string client_node_name = "test-flow-endpoint-client";
@@ -50,6 +50,8 @@ static void flow_endpoint(zio::socket_t& link, int socket, bool giver,
     node.online();
 
     zio::Flow flow(port, direction, credit);
+    const zio::flow::AdaptiveCredit adapt{1, 4 * credit};
+    if (adaptive) { flow.set_adaptive(adapt); }
 
     flow.bot();
 
@@ -115,6 +117,17 @@ static void flow_endpoint(zio::socket_t& link, int socket, bool giver,
 
     zio::info("[{} {}] credit:{} gave:{} ({:.3f} kHz) took:{} ({:.3f} kHz)",
               nodename, portname, credit, ngive, khz_give, ntake, khz_take);
+    if (adaptive) {
+        const auto stats = flow.credit_stats();
+        zio::info("[{} {}] window:{} [{},{}] grows:{} shrinks:{} starved:{} "
+                  "rtt:{:.1f} us drain:{:.3f} kHz",
+                  nodename, portname, stats.window, stats.min_window,
+                  stats.max_window, stats.grows, stats.shrinks,
+                  stats.starved, 1e6 * stats.rtt, 1e-3 * stats.drain);
+        assert(stats.window >= adapt.min_credit);
+        assert(stats.max_window <= adapt.max_credit);
+        assert(stats.window == flow.total_credit());
+    }
 
     ZIO_DEBUG("[{} {}] node going offline", nodename, portname);
     node.offline();
@@ -129,14 +142,15 @@ static void flow_endpoint(zio::socket_t& link, int socket, bool giver,
 
 #include "zio/actor.hpp"
 
-void test_flow(int credit)
+void test_flow(int credit, bool adaptive = false)
 {
     zio::context_t ctx;
 
     ZIO_DEBUG("test_flow: start actors with {} credit", credit);
 
-    zio::zactor_t one(ctx, flow_endpoint, ZMQ_SERVER, false, credit);
-    zio::zactor_t two(ctx, flow_endpoint, ZMQ_CLIENT, true, credit);
+    zio::zactor_t one(ctx, flow_endpoint, ZMQ_SERVER, false, credit,
+                      adaptive);
+    zio::zactor_t two(ctx, flow_endpoint, ZMQ_CLIENT, true, credit, adaptive);
 
     ZIO_DEBUG("test_flow: sleep");
     zio::sleep_ms(zio::time_unit_t{1000});
@@ -156,6 +170,8 @@ int main()
     test_flow(5);
     test_flow(2);
     test_flow(1);
+    test_flow(10, true);
+    test_flow(1, true);
 
     return 0;
 }
@@ -0,0 +1,126 @@
+#include "zio/flow.hpp"
+#include "zio/node.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+
+#include <thread>
+
+const int npairs = 4;
+const int ndats = 100;
+const int credit = 3;
+
+struct Endpoint
+{
+    zio::Flow flow;
+    bool giver;
+    int count{0};
+    bool sent_eot{false};
+    bool done{false};
+};
+
+int main()
+{
+    zio::init_all();
+
+    zio::Node node("test-flow-poller");
+    std::vector<zio::portptr_t> sports, cports;
+    for (int ind = 0; ind < npairs; ++ind) {
+        const std::string num = std::to_string(ind);
+        const std::string address =
+            "tcp://127.0.0.1:" + std::to_string(5570 + ind);
+        sports.push_back(node.port("server" + num, ZMQ_SERVER));
+        sports.back()->bind(address);
+        cports.push_back(node.port("client" + num, ZMQ_CLIENT));
+        cports.back()->connect(address);
+    }
+    node.online();
+
+    // Clients give on even pairs and take on odd ones.
+    std::vector<Endpoint> eps;
+    for (int ind = 0; ind < npairs; ++ind) {
+        const bool cgive = ind % 2 == 0;
+        const auto cdir = cgive ? zio::flow::direction_e::extract
+                                : zio::flow::direction_e::inject;
+        const auto sdir = cgive ? zio::flow::direction_e::inject
+                                : zio::flow::direction_e::extract;
+        eps.push_back(Endpoint{zio::Flow(cports[ind], cdir, credit), cgive});
+        eps.push_back(Endpoint{zio::Flow(sports[ind], sdir, credit), !cgive});
+    }
+
+    // The BOT handshake blocks so do it for clients in threads.
+    {
+        std::vector<std::thread> bots;
+        for (size_t ind = 0; ind < eps.size(); ind += 2) {
+            bots.emplace_back([&eps, ind]() {
+                bool ok = eps[ind].flow.bot();
+                assert(ok);
+            });
+        }
+        for (size_t ind = 1; ind < eps.size(); ind += 2) {
+            bool ok = eps[ind].flow.bot();
+            assert(ok);
+        }
+        for (auto& th : bots) { th.join(); }
+    }
+
+    // Not ready before any message is sent, nor blocking.
+    zio::Message dat;
+    for (auto& ep : eps) {
+        if (ep.giver) { assert(ep.flow.credit() == 0); }
+        else {
+            assert(!ep.flow.try_get(dat));
+        }
+    }
+
+    zio::poller_t<Endpoint> poller;
+    for (auto& ep : eps) {
+        poller.add(ep.flow.socket(), zio::event_flags::pollin, &ep);
+    }
+    std::vector<zio::poller_event<Endpoint>> events(eps.size());
+
+    size_t ndone = 0;
+    while (ndone < eps.size()) {
+        bool any = false;
+        for (auto& ep : eps) {
+            if (ep.done) { continue; }
+            const auto ev = ep.flow.ready();
+            if (ev == zio::event_flags::none) { continue; }
+            any = true;
+            try {
+                if (ep.giver and ep.count < ndats) {
+                    assert((ev & zio::event_flags::pollout) !=
+                           zio::event_flags::none);
+                    while (ep.count < ndats) {
+                        zio::Message msg;
+                        if (!ep.flow.try_put(msg)) { break; }
+                        ++ep.count;
+                    }
+                    if (ep.count == ndats) {
+                        ep.flow.eotack();  // begin EOT, no waiting
+                        ep.sent_eot = true;
+                    }
+                }
+                else if (ep.giver) {
+                    zio::Message msg;
+                    ep.flow.try_put(msg);
+                    assert(false);  // only the EOT reply is left
+                }
+                else {
+                    while (ep.flow.try_get(dat)) { ++ep.count; }
+                }
+            } catch (const zio::flow::end_of_transmission&) {
+                if (!ep.sent_eot) { ep.flow.eotack(); }
+                ep.done = true;
+                ++ndone;
+            }
+        }
+        if (any) { continue; }
+        const size_t nready = poller.wait_all(events, zio::time_unit_t{1000});
+        assert(nready > 0);
+    }
+
+    for (const auto& ep : eps) { assert(ep.count == ndats); }
+
+    node.offline();
+    return 0;
+}
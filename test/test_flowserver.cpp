@@ -0,0 +1,179 @@
+#include "zio/flow.hpp"
+#include "zio/node.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+
+#include <map>
+#include <thread>
+
+const int ndats = 100;
+const int credit = 5;
+
+static void giver(zio::portptr_t port)
+{
+    zio::Flow flow(port, zio::flow::direction_e::extract, credit);
+    bool ok = flow.bot();
+    assert(ok);
+    for (int ind = 0; ind < ndats; ++ind) {
+        zio::Message dat;
+        dat.set_label(std::to_string(ind));
+        ok = flow.put(dat);
+        assert(ok);
+    }
+    ok = flow.eot();
+    assert(ok);
+}
+
+static void taker(zio::portptr_t port)
+{
+    zio::Flow flow(port, zio::flow::direction_e::inject, credit);
+    bool ok = flow.bot();
+    assert(ok);
+    int count = 0;
+    while (true) {
+        zio::Message dat;
+        try {
+            ok = flow.get(dat);
+        } catch (const zio::flow::end_of_transmission&) {
+            flow.eotack();
+            break;
+        }
+        assert(ok);
+        ++count;
+    }
+    assert(count == ndats);
+}
+
+int main()
+{
+    zio::init_all();
+
+    const std::string address = "tcp://127.0.0.1:5561";
+    zio::Node node("test-flowserver");
+    auto sport = node.port("server", ZMQ_SERVER);
+    sport->bind(address);
+    std::vector<zio::portptr_t> cports;
+    for (int ind = 0; ind < 4; ++ind) {
+        cports.push_back(node.port("client" + std::to_string(ind), ZMQ_CLIENT));
+        cports.back()->connect(address);
+    }
+    node.online();
+
+    zio::FlowServer server(sport, credit);
+
+    std::vector<std::thread> clients;
+    clients.emplace_back(giver, cports[0]);
+    clients.emplace_back(giver, cports[1]);
+    clients.emplace_back(taker, cports[2]);
+    clients.emplace_back(taker, cports[3]);
+
+    std::map<zio::remote_identity_t, int> taken, given;
+    size_t nended = 0;
+    std::vector<zio::FlowServer::Event> events;
+    while (nended < clients.size()) {
+        if (!server.poll(events, zio::timeout_t{1000})) {
+            zio::error("test_flowserver: timeout");
+            return 1;
+        }
+        for (const auto& ev : events) {
+            if (ev.events & zio::FlowServer::botready) {
+                const auto dir = server.direction(ev.remid);
+                assert(server.botmsg(ev.remid).flow().credit == credit);
+                bool ok = server.accept(ev.remid);
+                assert(ok);
+                if (dir == zio::flow::direction_e::inject) {
+                    taken[ev.remid] = 0;
+                }
+                else {
+                    given[ev.remid] = 0;
+                }
+                continue;
+            }
+            if (ev.events & zio::FlowServer::readable) {
+                zio::Message dat;
+                while (server.get(ev.remid, dat)) {
+                    int& count = taken[ev.remid];
+                    assert(dat.label() == std::to_string(count));
+                    ++count;
+                }
+            }
+            else if (ev.events & zio::FlowServer::eotready) {
+                assert(taken[ev.remid] == ndats);
+                server.eot(ev.remid);  // acknowledge, flow ends
+                continue;
+            }
+            if (ev.events & zio::FlowServer::writable) {
+                int& count = given[ev.remid];
+                if (count == ndats) {
+                    server.eot(ev.remid);
+                    continue;
+                }
+                while (count < ndats and server.credit(ev.remid)) {
+                    zio::Message dat;
+                    bool ok = server.put(ev.remid, dat);
+                    assert(ok);
+                    ++count;
+                }
+            }
+            if (ev.events & zio::FlowServer::ended) {
+                if (taken.count(ev.remid)) {
+                    assert(taken[ev.remid] == ndats);
+                }
+                else {
+                    assert(given[ev.remid] == ndats);
+                }
+                ++nended;
+            }
+        }
+    }
+    for (auto& client : clients) { client.join(); }
+    assert(server.size() == 0);
+    assert(taken.size() == 2);
+    assert(given.size() == 2);
+
+    // A giving flow left idle reports writable only when credit
+    // arrives so poll() waits rather than spins.
+    std::thread idle([&]() {
+        zio::Flow flow(cports[0], zio::flow::direction_e::inject, credit);
+        bool ok = flow.bot();
+        assert(ok);
+        zio::Message dat;
+        try {
+            flow.get(dat);
+            assert(false);
+        } catch (const zio::flow::end_of_transmission&) {
+            flow.eotack();
+        }
+    });
+    zio::remote_identity_t remid;
+    bool credited = false, ended = false;
+    while (!ended) {
+        if (!server.poll(events, zio::timeout_t{1000})) {
+            assert(credited);
+            server.eot(remid);  // poll() waited, now end
+            continue;
+        }
+        for (const auto& ev : events) {
+            if (ev.events & zio::FlowServer::botready) {
+                remid = ev.remid;
+                server.accept(remid);
+            }
+            if (ev.events & zio::FlowServer::writable) {
+                assert(!credited);
+                credited = true;
+            }
+            if (ev.events & zio::FlowServer::ended) { ended = true; }
+        }
+    }
+    idle.join();
+
+    // An unknown flow is an error.
+    try {
+        server.credit(zio::remote_identity_t{"nobody"});
+        assert(false);
+    } catch (const zio::flow::local_error&) {
+    }
+
+    node.offline();
+    return 0;
+}
@@ -1,8 +1,25 @@
 #include "zio/message.hpp"
+#include "zio/flow.hpp"
 #include "zio/main.hpp"
+#include "zio/node.hpp"
 #include "zio/logging.hpp"
 
 #include <cassert>
+#include <cstdlib>
+#include <new>
+
+// Count allocations made by this thread so that libzmq's I/O threads
+// do not disturb the tally.
+static thread_local size_t nallocs = 0;
+
+void* operator new(size_t size)
+{
+    ++nallocs;
+    if (void* ptr = std::malloc(size ? size : 1)) { return ptr; }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
 
 void test_empty()
 {
@@ -21,11 +38,296 @@ void test_empty()
     assert(fobj == empty);
 }
 
+void test_label_cache()
+{
+    zio::Message msg("TEXT");
+    msg.set_label("{\"a\":1}");
+    const zio::json& lobj = msg.label_object();
+    assert(lobj["a"] == 1);
+    assert(&lobj == &msg.label_object());  // parsed once, cached
+
+    // edits are seen by the object and only serialized when needed
+    msg.label_object_ref()["b"] = 2;
+    assert(msg.label_object()["b"] == 2);
+    assert(zio::json::parse(msg.label()) == msg.label_object());
+    assert(zio::json::parse(msg.prefix().label)["b"] == 2);
+
+    // setting the string invalidates the cached object
+    msg.set_label("not json");
+    assert(msg.label_object().is_null());
+    assert(msg.label() == "not json");
+
+    // mutable access must not silently replace a text label
+    try {
+        msg.label_object_ref();
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+    assert(msg.label() == "not json");
+    msg.set_label("null");
+    assert(msg.label_object_ref().is_null());
+
+    msg.set_label_object({{"c", 3}});
+    auto parts = msg.toparts();
+    zio::Message msg2;
+    msg2.fromparts(parts);
+    assert(msg2.label_object()["c"] == 3);
+}
+
+void test_label_encoding()
+{
+    const zio::json lobj = {{"flow", "DAT"}, {"credit", 3}};
+    for (auto enc : {zio::label_encoding_e::json,
+                     zio::label_encoding_e::cbor,
+                     zio::label_encoding_e::msgpack}) {
+        zio::Message msg("FLOW");
+        msg.set_label_encoding(enc);
+        msg.set_label_object(lobj);
+        assert(zio::label_encoding(msg.label()) == enc);
+
+        zio::Message msg2;
+        msg2.fromparts(msg.toparts());
+        assert(msg2.label_encoding() == enc);
+        assert(msg2.label_object() == lobj);
+
+        // a recipient edit keeps the sender's encoding
+        msg2.label_object_ref()["credit"] = 4;
+        assert(zio::label_encoding(msg2.label()) == enc);
+        assert(zio::load_label(msg2.label())["credit"] == 4);
+    }
+    // a plain text label is left alone
+    zio::Message msg("TEXT");
+    msg.set_label("hello");
+    msg.set_label_encoding(zio::label_encoding_e::cbor);
+    assert(msg.label() == "hello");
+
+    // as is JSON which is not an object
+    for (std::string text : {"42", "[1,2]"}) {
+        zio::Message other("TEXT");
+        other.set_label(text);
+        other.set_label_encoding(zio::label_encoding_e::msgpack);
+        assert(other.label() == text);
+    }
+}
+
+void test_pool()
+{
+    zio::MessagePool pool(2);
+    zio::Message msg = pool.acquire("FLOW", zio::level::info);
+    assert(msg.form() == "FLOW");
+    msg.set_label(std::string(100, 'x'));
+    msg.add(zio::message_t(10));
+    msg.set_seqno(42);
+    const size_t cap = msg.prefix().label.capacity();
+    pool.release(std::move(msg));
+    assert(pool.size() == 1);
+
+    // recycled message is cleared but keeps its label capacity
+    zio::Message again = pool.acquire();
+    assert(pool.size() == 0);
+    assert(again.form() == "    ");
+    assert(again.level() == zio::level::undefined);
+    assert(again.label().empty());
+    assert(again.label_object().is_null());
+    assert(again.payload().empty());
+    assert(again.seqno() == 0);
+    assert(again.prefix().label.capacity() == cap);
+
+    // full pool drops extras
+    for (int ind = 0; ind < 3; ++ind) { pool.release(zio::Message()); }
+    assert(pool.size() == pool.max_size());
+}
+
+void test_pool_allocations()
+{
+    const std::string address = "tcp://127.0.0.1:5564";
+    zio::Node node("test-message");
+    auto server = node.port("server", ZMQ_SERVER);
+    server->bind(address);
+    auto client = node.port("client", ZMQ_CLIENT);
+    client->connect(address);
+    node.online();
+
+    auto cycle = [&]() {
+        zio::Message msg = client->pool().acquire("FLOW");
+        zio::flow::Label lab(msg);
+        lab.msgtype(zio::flow::msgtype_e::dat);
+        lab.credit(1);
+        msg.add(zio::message_t(10));
+        bool ok = client->send(msg);
+        assert(ok);
+        client->pool().release(std::move(msg));
+
+        zio::Message got = server->pool().acquire();
+        ok = server->recv(got, zio::timeout_t{1000});
+        assert(ok);
+        assert(got.payload().size() == 1);
+        server->pool().release(std::move(got));
+    };
+
+    // Warm up so pooled messages and port containers are allocated.
+    for (int ind = 0; ind < 10; ++ind) { cycle(); }
+
+    const size_t before = nallocs;
+    for (int ind = 0; ind < 100; ++ind) { cycle(); }
+    assert(nallocs == before);
+
+    node.offline();
+}
+
+void test_header_template()
+{
+    zio::Message msg("FLOW", zio::level::info);
+    msg.set_label_object({{"flow", "DAT"}});
+    msg.set_seqno(7);
+    zio::HeaderTemplate head(msg);
+
+    for (zio::seqno_t seqno = 7; seqno < 10; ++seqno) {
+        zio::multipart_t payload;
+        payload.addstr("data");
+        auto parts = head.toparts(std::move(payload), 100 + seqno);
+        assert(parts.size() == 3);
+        assert(parts[0].to_string() == msg.prefix().dumps());
+
+        zio::Message got;
+        got.fromparts(std::move(parts));
+        assert(got.form() == "FLOW");
+        assert(got.level() == zio::level::info);
+        assert(got.label_object()["flow"] == "DAT");
+        assert(got.seqno() == seqno);
+        assert(got.granule() == 100 + seqno);
+        assert(got.payload()[0].to_string() == "data");
+    }
+    assert(head.coord().seqno == 10);
+}
+
+void test_flow_fields()
+{
+    zio::Message msg("FLOW");
+    assert(msg.flow().empty());
+    assert(msg.toparts()[1].size() == sizeof(zio::CoordHeader));
+
+    msg.flow().msgtype = 2;
+    msg.flow().credit = 5;
+    auto parts = msg.toparts();
+    assert(parts[1].size() ==
+           sizeof(zio::CoordHeader) + sizeof(zio::FlowHeader));
+    zio::Message got;
+    got.fromparts(parts);
+    assert(got.flow().msgtype == 2);
+    assert(got.flow().credit == 5);
+    assert(got.label().empty());
+
+    zio::Message dec;
+    dec.decode(msg.encode());
+    assert(dec.flow().msgtype == 2);
+
+    zio::HeaderTemplate head(msg);
+    got.fromparts(head.toparts(zio::multipart_t{}));
+    assert(got.flow().credit == 5);
+
+    got.clear();
+    assert(got.flow().empty());
+}
+
+void test_flow_label()
+{
+    using zio::flow::direction_e;
+    using zio::flow::msgtype_e;
+
+    zio::Message msg("FLOW");
+    msg.set_label_object({{"app", 1}});
+    zio::flow::Label lab(msg);
+    assert(lab.msgtype() == msgtype_e::unknown);
+    lab.msgtype(msgtype_e::bot);
+    lab.direction(direction_e::inject);
+    lab.credit(10);
+    assert(lab.msgtype() == msgtype_e::bot);
+    assert(lab.direction() == direction_e::inject);
+    assert(lab.credit() == 10);
+    assert(lab.window() == 0);
+    lab.window(12);
+    assert(msg.flow().window == 12);
+    lab.window(100000);
+    assert(lab.window() == 65535);
+    // the label holds only application attributes
+    assert(msg.label() == "{\"app\":1}");
+
+    // clearing the type keeps the other attributes, also when sent
+    lab.msgtype(msgtype_e::unknown);
+    assert(lab.msgtype() == msgtype_e::unknown);
+    assert(lab.direction() == direction_e::inject);
+    assert(lab.credit() == 10);
+    zio::Message sent;
+    sent.fromparts(msg.toparts());
+    zio::flow::Label slab(sent);
+    assert(slab.msgtype() == msgtype_e::unknown);
+    assert(slab.direction() == direction_e::inject);
+    assert(slab.credit() == 10);
+    lab.msgtype(msgtype_e::bot);
+
+    // as sent by older peers
+    zio::Message old("FLOW");
+    old.set_label_object(
+        {{"flow", "BOT"}, {"direction", "extract"}, {"credit", 3}, {"app", 1}});
+    zio::flow::Label olab(old);
+    assert(old.flow().empty());
+    assert(olab.msgtype() == msgtype_e::bot);
+    assert(olab.direction() == direction_e::extract);
+    assert(olab.credit() == 3);
+    olab.direction(direction_e::inject);
+    assert(!old.flow().empty());
+    assert(olab.msgtype() == msgtype_e::bot);
+    assert(olab.direction() == direction_e::inject);
+    assert(olab.credit() == 3);
+    assert(old.label() == "{\"app\":1}");
+}
+
+void test_zero_copy()
+{
+    zio::Message msg("BULK");
+    std::string big(1024, 'x');
+    msg.add(zio::message_t(big.data(), big.size()));
+    const void* data = msg.payload()[0].data();
+
+    // moving out hands over the very same frame
+    auto parts = std::move(msg).toparts();
+    assert(parts.size() == 3);
+    assert(parts[2].data() == data);
+    assert(msg.payload().empty());
+
+    zio::Message msg2;
+    msg2.fromparts(std::move(parts));
+    assert(msg2.form() == "BULK");
+    assert(msg2.payload().size() == 1);
+    assert(msg2.payload()[0].data() == data);
+
+    // a large part decoded from an rvalue references the encoding
+    auto spmsg = msg2.encode();
+    const char* enc_beg = spmsg.data<char>();
+    const char* enc_end = enc_beg + spmsg.size();
+    zio::Message msg3;
+    msg3.decode(std::move(spmsg));
+    assert(msg3.form() == "BULK");
+    assert(msg3.payload().size() == 1);
+    const char* got = msg3.payload()[0].data<char>();
+    assert(got > enc_beg and got < enc_end);
+    assert(std::string(got, msg3.payload()[0].size()) == big);
+}
+
 int main()
 {
     zio::init_all();
 
     test_empty();
+    test_label_cache();
+    test_label_encoding();
+    test_pool();
+    test_pool_allocations();
+    test_header_template();
+    test_flow_fields();
+    test_flow_label();
+    test_zero_copy();
 
     std::string label = "Extra spicy";
 
@@ -88,5 +390,18 @@ int main()
         assert(empty.prefix().dumps().substr(0, 8) == "ZIO0FOO ");
     }
 
+    {
+        zio::PrefixHeader ph{zio::level::warning, "JSON", "{}"};
+        zio::message_t part;
+        ph.dump(part);
+        assert(part.to_string() == "ZIO6JSON{}");
+        zio::PrefixHeaderView view;
+        assert(view.loads(part));
+        assert(view.level == zio::level::warning);
+        assert(view.form == "JSON");
+        assert(view.label == "{}");
+        assert(!view.loads(part.data(), 7));
+    }
+
     return 0;
 }
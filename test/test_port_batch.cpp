@@ -0,0 +1,79 @@
+#include "zio/node.hpp"
+#include "zio/message.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+
+#include <chrono>
+
+int main()
+{
+    zio::init_all();
+
+    zio::Node node("test-port-batch");
+    auto server = node.port("server", ZMQ_SERVER);
+    auto client = node.port("client", ZMQ_CLIENT);
+    server->bind("tcp://127.0.0.1:5557");
+    client->connect("tcp://127.0.0.1:5557");
+    node.online();
+
+    // held until three are pending, last two until flushed
+    client->set_batching(3, 65536, std::chrono::seconds(10));
+    for (int ind = 0; ind < 5; ++ind) {
+        zio::Message msg("TEXT");
+        msg.set_label(std::to_string(ind));
+        msg.add(zio::message_t(100 * ind));
+        client->send(msg);
+    }
+    assert(client->flush());
+    assert(!client->flush());
+
+    zio::remote_identity_t remid;
+    zio::seqno_t last = 0;
+    for (int ind = 0; ind < 5; ++ind) {
+        zio::Message msg;
+        bool ok = server->recv(msg, zio::timeout_t{1000});
+        assert(ok);
+        assert(msg.form() == "TEXT");
+        assert(msg.label() == std::to_string(ind));
+        assert(msg.payload().size() == 1);
+        assert(msg.payload()[0].size() == (size_t)(100 * ind));
+        assert(msg.seqno() > last);
+        last = msg.seqno();
+        assert(msg.remote_id().size() > 0);
+        remid = msg.remote_id();
+    }
+
+    // a batch is sent back to the same remote and a waiting recv
+    // flushes any held messages.
+    server->set_batching(10);
+    for (int ind = 0; ind < 2; ++ind) {
+        zio::Message msg("TEXT");
+        msg.set_label("reply");
+        msg.set_remote_id(remid);
+        server->send(msg);
+    }
+    zio::Message nothing;
+    assert(!server->recv(nothing, zio::timeout_t{10}));
+    for (int ind = 0; ind < 2; ++ind) {
+        zio::Message msg;
+        bool ok = client->recv(msg, zio::timeout_t{1000});
+        assert(ok);
+        assert(msg.label() == "reply");
+    }
+
+    // an application message of form BTCH is not taken for a batch
+    client->set_batching(0, 0);
+    zio::Message app("BTCH");
+    app.set_label("app");
+    for (int ind = 0; ind < 3; ++ind) { app.add(zio::message_t(10)); }
+    client->send(app);
+    zio::Message got;
+    bool ok = server->recv(got, zio::timeout_t{1000});
+    assert(ok);
+    assert(got.form() == "BTCH");
+    assert(got.label() == "app");
+    assert(got.payload().size() == 3);
+
+    node.offline();
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "zio/node.hpp"
+#include "zio/message.hpp"
+#include "zio/main.hpp"
+#include "zio/logging.hpp"
+
+int main()
+{
+    zio::init_all();
+
+    zio::Node node("test-port-recv-many");
+    auto server = node.port("server", ZMQ_SERVER);
+    auto client = node.port("client", ZMQ_CLIENT);
+    server->bind("tcp://127.0.0.1:5559");
+    client->connect("tcp://127.0.0.1:5559");
+    node.online();
+
+    const int nsend = 10;
+    for (int ind = 0; ind < nsend; ++ind) {
+        zio::Message msg("TEXT");
+        msg.set_label(std::to_string(ind));
+        client->send(msg);
+    }
+    zio::sleep_ms(zio::time_unit_t{100});  // let all arrive
+
+    std::vector<zio::Message> msgs;
+    size_t got = server->recv_many(msgs, 4, zio::timeout_t{1000});
+    assert(got == 4);
+    assert(msgs.size() == 4);
+
+    // the rest, reusing the vector
+    got += server->recv_many(msgs, 100, zio::timeout_t{1000});
+    assert(got == nsend);
+    assert(msgs.size() == nsend - 4);
+    for (size_t ind = 0; ind < nsend - 4; ++ind) {
+        assert(msgs[ind].label() == std::to_string(ind + 4));
+        assert(msgs[ind].remote_id().size() > 0);
+    }
+
+    // nothing left
+    assert(0 == server->recv_many(msgs, 100, zio::timeout_t{10}));
+
+    node.offline();
+    return 0;
+}
@@ -1,9 +1,32 @@
 #include "zio/tens.hpp"
+#include "zio/util.hpp"
 
+#include <cmath>
+#include <complex>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
+
+static_assert(zio::tens::dtype_traits<float>::kind == 'f');
+static_assert(zio::tens::dtype_traits<std::complex<double>>::word == 16);
 
 int main()
 {
+    assert(std::string(zio::tens::dtype<float>()) == "<f4");
+    assert(std::string(zio::tens::dtype<int16_t>()) == "<i2");
+    assert(std::string(zio::tens::dtype<uint8_t>()) == "|u1");
+    assert(std::string(zio::tens::dtype<std::complex<float>>()) == "<c8");
+    assert(std::string(zio::tens::dtype<std::complex<double>>()) == "<c16");
+    assert(std::string(zio::tens::dtype<bool>()) == "|b1");
+    assert(std::string(zio::tens::dtype<std::array<char, 12>>()) == "|V12");
+    // as written by older versions
+    assert(zio::tens::dtype_matches<float>("f", 4));
+    assert(!zio::tens::dtype_matches<float>("f", 8));
+    assert(!zio::tens::dtype_matches<float>("i", 4));
+    assert(!zio::tens::dtype_matches<float>(">f4", 4));
+    assert(zio::tens::dtype_matches<int8_t>("|i1", 1));
+
     float tensor[2][3][4] = {0};
     const float* tensor1 = (float*)tensor;
 
@@ -22,6 +45,7 @@ int main()
     auto lobj = msg.label_object();
     std::cout << lobj << std::endl;
     auto md = lobj[zio::tens::form]["tensors"][0];
+    assert(md["dtype"] == "<f4");
 
     for (int ind = 0; ind < 3; ++ind) {
         assert(shape[ind] == md["shape"][ind].get<size_t>());
@@ -39,5 +63,507 @@ int main()
     assert(spmp.size());
     assert(!spmp.empty());
 
+    // type mismatch
+    assert(!zio::tens::at<double>(msg, 0));
+    assert(!zio::tens::at<int>(msg, 0));
+
+    // As written by older versions.
+    {
+        zio::Message old(zio::tens::form);
+        zio::tens::append(old, zio::message_t(tensor1, 24 * sizeof(float)),
+                          shape, sizeof(float), "f");
+        assert(zio::tens::at<float>(old, 0));
+        assert(!zio::tens::at<int32_t>(old, 0));
+        assert(zio::tens::Reader(old).view<float>(0));
+    }
+
+    // Views from a single parse of the label.
+    float values[2][3][4];
+    for (size_t ind = 0; ind < 24; ++ind) { ((float*)values)[ind] = ind; }
+    zio::tens::append(msg, (float*)values, shape, {{"name", "values"}});
+    zio::tens::Reader reader(msg);
+    assert(reader.size() == 2);
+    const auto& ref = reader.ref(1);
+    assert(ref);
+    assert(ref.shape == shape);
+    assert(ref.strides == std::vector<size_t>({12, 4, 1}));
+    assert(ref.word == sizeof(float));
+    assert(ref.metadata["name"] == "values");
+    assert(!reader.view<double>(1));
+    assert(!reader.view<int32_t>(1));
+    assert(!reader.view<float>(2));
+    auto view = reader.view<float>(1);
+    assert(view);
+    assert(view.rank() == 3);
+    assert(view.size() == 24);
+    assert(view(1, 2, 3) == values[1][2][3]);
+    assert(view.at({0, 1, 2}) == values[0][1][2]);
+    try {
+        view.at({2, 0, 0});
+        assert(false);
+    }
+    catch (const std::out_of_range& err) {
+    }
+
+    // Strided sources
+    {
+        zio::Message msg8(zio::tens::form);
+        // a 2 x 3 Fortran order matrix is sent as-is
+        const double fort[] = {0, 3, 1, 4, 2, 5};
+        zio::tens::append_strided(msg8, fort, {2, 3}, {1, 2});
+        // a 2 x 2 x 2 sub-block of values is gathered
+        zio::tens::append_strided(msg8, &values[0][1][1], {2, 2, 2},
+                                  {12, 4, 1});
+        // every other column of the sub-block
+        zio::tens::append_strided(msg8, &values[0][0][0], {2, 3, 2},
+                                  {12, 4, 2});
+
+        zio::tens::Reader reader(msg8);
+        assert(reader.size() == 3);
+        const auto fmat = reader.view<double>(0);
+        assert(fmat.strides() == std::vector<size_t>({1, 2}));
+        for (size_t ind = 0; ind < 6; ++ind) {
+            assert(fmat(ind / 3, ind % 3) == ind);
+        }
+        const auto sub = reader.view<float>(1);
+        assert(sub.strides() == std::vector<size_t>({4, 2, 1}));
+        assert(sub(1, 1, 1) == values[1][2][2]);
+        assert(sub(0, 1, 0) == values[0][2][1]);
+        const auto evens = reader.view<float>(2);
+        assert(evens(1, 2, 1) == values[1][2][2]);
+        assert(evens(0, 1, 1) == values[0][1][2]);
+
+        assert((zio::tens::order_strides({2, 3, 4}, {2, 1, 0}) ==
+                zio::tens::c_strides({2, 3, 4})));
+        assert(zio::tens::order_strides({2, 3}, {0, 0}).empty());
+    }
+
+    // Checksums
+    {
+        assert(zio::crc32c("123456789", 9) == 0xe3069283);
+        assert(zio::crc32c("56789", 5, zio::crc32c("1234", 4)) == 0xe3069283);
+        std::vector<char> big(100000), copy(100000);
+        for (size_t ind = 0; ind < big.size(); ++ind) { big[ind] = ind * 7; }
+        assert(zio::crc32c_copy(copy.data(), big.data(), big.size()) ==
+               zio::crc32c(big.data(), big.size()));
+        assert(copy == big);
+
+        zio::Message good(zio::tens::form);
+        zio::tens::set_checksums(good);
+        zio::tens::append(good, (float*)values, shape);
+        zio::Message binary(zio::tens::form);
+        zio::tens::set_checksums(binary);
+        zio::tens::Builder builder(binary);
+        builder.append((float*)values, shape);
+        builder.finish();
+
+        // the choice is per message
+        zio::Message plain(zio::tens::form);
+        zio::tens::append(plain, (float*)values, shape);
+        assert(!zio::tens::Reader(plain).ref(0).has_checksum);
+
+        for (auto* one : {&good, &binary}) {
+            zio::tens::Reader reader(*one);
+            assert(reader.ref(0).has_checksum);
+            assert(reader.ref(0).verify());
+            assert(zio::tens::at<float>(*one, 0));
+
+            // corrupt the data in place
+            auto parts = std::move(*one).toparts();
+            parts[2].data<char>()[5] ^= 1;
+            zio::Message bad;
+            bad.fromparts(std::move(parts));
+            assert(!zio::tens::Reader(bad).ref(0).verify());
+            assert(!zio::tens::at<float>(bad, 0));
+            assert(zio::tens::at(bad, 0).empty());
+        }
+
+        // a corrupt descriptor count is rejected without allocating
+        zio::Message counted(zio::tens::form);
+        zio::tens::Builder cbuilder(counted);
+        cbuilder.append((float*)values, shape);
+        cbuilder.finish();
+        auto parts = std::move(counted).toparts();
+        memset(parts[parts.size() - 1].data<char>() + 8, 0xff, 4);
+        zio::Message huge;
+        huge.fromparts(std::move(parts));
+        assert(zio::tens::Reader(huge).size() == 0);
+        assert(zio::tens::at(huge, 0).empty());
+    }
+
+    // Quantized tensors
+    {
+        std::vector<float> wave(1000);
+        for (size_t ind = 0; ind < wave.size(); ++ind) {
+            wave[ind] = 100 * sin(0.01 * ind) + 1000;
+        }
+        // halves are exact for small integers, some subnormals, inf
+        const float exact[] = {0, -2, 1024, 65504, 6.103515625e-05f,
+                               5.9604644775390625e-8f, INFINITY, 1.5};
+        uint16_t half[8];
+        float back[8];
+        zio::tens::float_to_half(exact, half, 8);
+        zio::tens::half_to_float(half, back, 8);
+        assert(memcmp(exact, back, sizeof(exact)) == 0);
+        assert(half[7] == 0x3e00);
+        zio::tens::float_to_bfloat(exact, half, 8);
+        zio::tens::bfloat_to_float(half, back, 8);
+        assert(back[1] == -2 and back[2] == 1024 and back[6] == INFINITY);
+
+        zio::Message qmsg(zio::tens::form);
+        const std::vector<size_t> qshape{10, 100};
+        using zio::tens::quant_e;
+        zio::tens::append_quantized(qmsg, wave.data(), qshape, {quant_e::f16});
+        zio::tens::append_quantized(qmsg, wave.data(), qshape, {quant_e::bf16});
+        zio::tens::append_quantized(qmsg, wave.data(), qshape, {quant_e::i16});
+        for (size_t ind = 0; ind < 3; ++ind) {
+            assert(qmsg.payload()[ind].size() == 2000);
+        }
+
+        zio::Message got;
+        got.fromparts(qmsg.toparts());
+        zio::tens::Reader reader(got);
+        assert(reader.ref(0).dtype == "<f2");
+        assert(reader.ref(2).quant == "i16");
+        assert(!reader.view<float>(0));
+        assert(reader.quantized<uint16_t>(1));
+        assert(reader.quantized<int16_t>(2));
+        assert(!reader.quantized<float>(2));
+        // relative precision of f16, bf16 and range/65534 for i16
+        const float tol[] = {1100.0f / 2048, 1100.0f / 256, 200.0f / 65534};
+        for (size_t ind = 0; ind < 3; ++ind) {
+            const auto dec = reader.dequantize(ind);
+            assert(dec.size() == wave.size());
+            for (size_t el = 0; el < wave.size(); ++el) {
+                assert(std::abs(dec[el] - wave[el]) <= tol[ind]);
+            }
+        }
+        assert(reader.dequantize(5).empty());
+
+        // non-finite values do not spoil the i16 range
+        const float odd[] = {NAN, -INFINITY, 1, 2, 3, INFINITY};
+        zio::Message nmsg(zio::tens::form);
+        zio::tens::append_quantized(nmsg, odd, {6}, {quant_e::i16});
+        const auto nref = zio::tens::Reader(nmsg).ref(0);
+        assert(std::isfinite(nref.quant_scale) and nref.quant_scale > 0);
+        assert(nref.quant_offset == 2);
+        const auto ndec = zio::tens::Reader(nmsg).dequantize(0);
+        const float nwant[] = {2, 1, 1, 2, 3, 3};
+        for (size_t el = 0; el < 6; ++el) {
+            assert(std::abs(ndec[el] - nwant[el]) <= 2.0f / 65534);
+        }
+    }
+
+    // Binary described tensors
+    {
+        zio::Message msg3(zio::tens::form);
+        msg3.add(zio::message_t((char*)nullptr, 0));  // unrelated part
+        zio::tens::Builder builder(msg3);
+        const size_t ntens = 1000;
+        std::vector<int16_t> chan(100);
+        for (size_t ind = 0; ind < ntens; ++ind) {
+            chan[0] = ind;
+            builder.append(chan.data(), {chan.size()});
+        }
+        builder.finish();
+        assert(builder.size() == ntens);
+        assert(msg3.payload().size() == ntens + 2);
+
+        // round trip and read without JSON tensor descriptions
+        zio::Message msg4;
+        msg4.fromparts(msg3.toparts());
+        assert(msg4.label_object()[zio::tens::form].size() == 1);
+        zio::tens::Reader reader(msg4);
+        assert(reader.size() == ntens);
+        for (size_t ind = 0; ind < ntens; ++ind) {
+            auto view = reader.view<int16_t>(ind);
+            assert(view);
+            assert(view.shape()[0] == chan.size());
+            assert(view(0) == (int16_t)ind);
+        }
+        assert(zio::tens::at<int16_t>(msg4, 7)[0] == 7);
+        assert(!zio::tens::at<float>(msg4, 7));
+
+        // can not mix with JSON described tensors
+        try {
+            zio::tens::Builder bad(msg);
+            assert(false);
+        }
+        catch (const std::runtime_error& err) {
+        }
+    }
+
+    // Packed into one frame
+    {
+        zio::Message msg(zio::tens::form);
+        zio::tens::Builder builder(msg, 100);  // to grow
+        assert(builder.packed());
+        const size_t ntens = 100;
+        std::vector<int16_t> chan(33);  // not a multiple of alignment
+        for (size_t ind = 0; ind < ntens; ++ind) {
+            chan[0] = ind;
+            builder.append(chan.data(), {chan.size()});
+        }
+        const float one[2] = {1, 2};
+        builder.append(one, {2});
+        builder.finish();
+        assert(builder.size() == ntens + 1);
+        assert(msg.payload().size() == 2);
+        const auto& pack = msg.payload()[0];
+        assert(zio::tens::is_aligned(pack.data(), 64));
+        assert(pack.size() == ntens * 128 + sizeof(one));
+
+        zio::Message got;
+        got.fromparts(msg.toparts());
+        zio::tens::Reader reader(got);
+        assert(reader.size() == ntens + 1);
+        for (size_t ind = 0; ind < ntens; ++ind) {
+            const auto& ref = reader.ref(ind);
+            assert(ref.part == 0);
+            assert(ref.part_offset == ind * 128);
+            assert(ref.nbytes == chan.size() * sizeof(int16_t));
+            auto view = reader.view<int16_t>(ind);
+            assert(view);
+            assert(view(0) == (int16_t)ind);
+        }
+        assert(zio::tens::at<int16_t>(got, 7)[0] == 7);
+        assert(zio::tens::at<float>(got, ntens)[1] == 2);
+        assert(!zio::tens::at<float>(got, 7));
+        assert(zio::tens::at(got, 7).empty());  // shares its part
+        // one copy aligns every tensor of the frame
+        assert(zio::tens::align(got) <= 1);
+        zio::tens::Reader aligned(got);
+        for (size_t ind = 0; ind < ntens; ++ind) {
+            assert(zio::tens::is_aligned(aligned.ref(ind).data, 64));
+        }
+        assert(0 == zio::tens::align(got));
+
+        // checksums cover each tensor, not the frame
+        zio::Message msg2(zio::tens::form);
+        zio::tens::set_checksums(msg2);
+        {
+            zio::tens::Builder b2(msg2, 1024);
+            b2.append(chan.data(), {chan.size()});
+            b2.append(chan.data(), {chan.size()});
+            b2.finish();
+        }
+        assert(zio::tens::at<int16_t>(msg2, 1));
+        {
+            auto parts = msg2.toparts();
+            parts[2].data<int16_t>()[64] ^= 1;  // second tensor
+            msg2.fromparts(std::move(parts));
+        }
+        assert(zio::tens::at<int16_t>(msg2, 0));
+        assert(!zio::tens::at<int16_t>(msg2, 1));
+
+        // unfinished builders release their frame
+        {
+            zio::Message msg3(zio::tens::form);
+            zio::tens::Builder b3(msg3, 1 << 20);
+            b3.append(chan.data(), {chan.size()});
+        }
+    }
+
+    // Sparse tensors
+    {
+        std::vector<float> dense(24, 0);
+        dense[3] = 1;
+        dense[13] = 2;
+        dense[23] = 3;
+        zio::Message msg5(zio::tens::form);
+        zio::tens::append_nonzero(msg5, dense.data(), shape);
+        assert(msg5.payload().size() == 2);
+        assert(msg5.payload()[0].size() == 3 * sizeof(float));
+        assert(msg5.payload()[1].size() == 3 * 3 * sizeof(uint32_t));
+
+        // 3 x 4 matrix with row 1 empty
+        const float vals[] = {5, 6, 7};
+        const uint16_t indptr[] = {0, 2, 2, 3};
+        const uint16_t cols[] = {1, 3, 0};
+        zio::tens::append_csr(msg5, vals, indptr, cols, {3, 4});
+        assert(msg5.payload().size() == 5);
+
+        zio::Message got;
+        got.fromparts(msg5.toparts());
+        zio::tens::Reader reader(got);
+        assert(reader.size() == 2);
+        assert(reader.ref(0).sparse());
+        assert(reader.ref(0).nnz == 3);
+        assert(!reader.view<float>(0));
+        assert(!reader.sparse<float>(1));  // wrong index type
+        assert(!(reader.sparse<double, uint16_t>(1)));
+
+        auto coo = reader.sparse<float>(0);
+        assert(coo);
+        assert(!coo.csr());
+        assert(coo.nnz() == 3);
+        assert(coo.indices(1)[1] == 0);  // 13 is (1,0,1)
+        assert(coo.indices(2)[1] == 1);
+        assert(coo.densify() == dense);
+
+        auto csr = reader.sparse<float, uint16_t>(1);
+        assert(csr);
+        assert(csr.csr());
+        const auto mat = csr.densify();
+        assert(mat.size() == 12);
+        assert(mat[1] == 5 and mat[3] == 6 and mat[8] == 7);
+        assert(mat[0] == 0 and mat[4] == 0);
+        size_t nseen = 0;
+        csr.for_each_block([&](const size_t* off, const float* val, size_t n) {
+            for (size_t ind = 0; ind < n; ++ind) {
+                assert(mat[off[ind]] == val[ind]);
+            }
+            nseen += n;
+        });
+        assert(nseen == 3);
+
+        // indices outside the shape are caught
+        const uint32_t bad[] = {0, 9};
+        zio::Message msg6(zio::tens::form);
+        zio::tens::append_coo(msg6, vals, bad, 1, {2, 4});
+        try {
+            zio::tens::Reader(msg6).sparse<float>(0).densify();
+            assert(false);
+        }
+        catch (const std::out_of_range& err) {
+        }
+
+        // shapes whose size overflows are not resolved
+        const std::vector<size_t> wide{1ULL << 32, 1ULL << 32};
+        zio::Message msg7(zio::tens::form);
+        // wraps to 4 elements
+        zio::tens::append(msg7, zio::message_t(16), {(1ULL << 62) + 1, 4}, 4,
+                          "<f4");
+        const uint32_t far[] = {0, 1};
+        zio::tens::append_coo(msg7, vals, far, 1, wide);
+        zio::tens::Reader reader7(msg7);
+        assert(!reader7.ref(0) and !reader7.view<float>(0));
+        assert(!reader7.ref(1) and !reader7.sparse<float>(1));
+    }
+
+    // Chunked tensors, sent out of order
+    {
+        const std::vector<size_t> full{10, 3};
+        std::vector<int32_t> whole(30);
+        for (size_t ind = 0; ind < 30; ++ind) { whole[ind] = ind; }
+        std::vector<zio::Message> msgs;
+        for (size_t row : {4, 0, 8}) {
+            zio::Message one(zio::tens::form);
+            const size_t nrows = std::min((size_t)4, full[0] - row);
+            zio::tens::append_chunk(one, whole.data() + row * 3, nrows, row,
+                                    full, "adc");
+            msgs.push_back(zio::Message());
+            msgs.back().fromparts(one.toparts());
+        }
+        const auto cref = zio::tens::Reader(msgs[0]).ref(0);
+        assert(cref.chunk == "adc");
+        assert(cref.offset == 4 and cref.total == 10);
+        assert(cref.shape == std::vector<size_t>({4, 3}));
+
+        zio::tens::Reassembler ras;
+        assert(ras.add(msgs[0]) == 1);
+        assert(ras.has("adc"));
+        assert(ras.ready("adc") == 0);
+        assert(ras.add(msgs[1]) == 1);
+        assert(ras.ready("adc") == 8);
+        assert(!ras.complete("adc"));
+        auto part = ras.view<int32_t>("adc");
+        assert(part.shape()[0] == 8);
+        assert(part(7, 2) == 23);
+        assert(!ras.view<float>("adc"));
+
+        ras.add(msgs[2]);
+        assert(ras.complete("adc"));
+        assert(ras.ref("adc").shape == full);
+        auto data = ras.take("adc");
+        assert(!ras.has("adc"));
+        assert(data.size() == 30 * sizeof(int32_t));
+        assert(memcmp(data.data(), whole.data(), data.size()) == 0);
+
+        // chunks of one id must agree
+        zio::Message other(zio::tens::form);
+        zio::tens::append_chunk(other, whole.data(), 2, 0, {10, 3}, "x");
+        zio::tens::append_chunk(other, whole.data(), 1, 2, {10, 2}, "x");
+        try {
+            ras.add(other);
+            assert(false);
+        }
+        catch (const std::runtime_error& err) {
+        }
+
+        // an untrusted total is bounded
+        zio::Message big(zio::tens::form);
+        zio::tens::append_chunk(big, whole.data(), 2, 0, {1ULL << 40, 3},
+                                "big");
+        try {
+            ras.add(big);
+            assert(false);
+        }
+        catch (const std::runtime_error& err) {
+        }
+        assert(!ras.has("big"));
+
+        // as is an untrusted offset
+        zio::Message far(zio::tens::form);
+        zio::tens::append_chunk(far, whole.data(), 1, 0, full, "far");
+        far.label_object_ref()[zio::tens::form]["tensors"][0]["chunk"]
+                              ["offset"] = std::numeric_limits<size_t>::max();
+        try {
+            ras.add(far);
+            assert(false);
+        }
+        catch (const std::runtime_error& err) {
+        }
+        assert(!ras.has("far"));
+
+        // a corrupt chunk is rejected, not reassembled
+        zio::Message crc(zio::tens::form);
+        zio::tens::set_checksums(crc);
+        zio::tens::append_chunk(crc, whole.data(), 2, 0, full, "crc");
+        auto parts = crc.toparts();
+        parts[2].data<char>()[3] ^= 1;
+        zio::Message bad;
+        bad.fromparts(std::move(parts));
+        try {
+            ras.add(bad);
+            assert(false);
+        }
+        catch (const std::runtime_error& err) {
+        }
+        assert(!ras.has("crc"));
+    }
+
+    // Misaligned data, as when received, is copied to be aligned.
+    {
+        auto raw = std::make_shared<std::vector<char>>(256);
+        float* odd = (float*)(raw->data() + 4);
+        for (size_t ind = 0; ind < 24; ++ind) { odd[ind] = ind; }
+        zio::Message msg7(zio::tens::form);
+        zio::tens::append(msg7, odd, shape, raw);
+        zio::tens::append(msg7, (float*)values, shape);
+        assert(!zio::tens::is_aligned(zio::tens::at<float>(msg7, 0), 64));
+
+        zio::tens::reset_align_stats();
+        const size_t ncopied = zio::tens::align(msg7);
+        assert(zio::tens::align_stats().copies == ncopied);
+        assert(zio::tens::align_stats().bytes == ncopied * 24 * sizeof(float));
+        zio::tens::Reader reader(msg7);
+        for (size_t ind = 0; ind < reader.size(); ++ind) {
+            assert(zio::tens::is_aligned(reader.ref(ind).data, 64));
+        }
+        assert(reader.view<float>(0)(1, 2, 3) == 23);
+        assert(0 == zio::tens::align(msg7));
+    }
+
+    // Externally owned data is referenced, not copied.
+    auto buffer = std::make_shared<std::vector<float>>(24, 1.0);
+    {
+        zio::Message msg2(zio::tens::form);
+        zio::tens::append(msg2, buffer->data(), shape, buffer);
+        assert(buffer.use_count() == 2);
+        assert(zio::tens::at<float>(msg2, 0) == buffer->data());
+    }
+    assert(buffer.use_count() == 1);
+
     return 0;
 }